@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+#include <img/image.hpp>
+#include <img/tiled.hpp>
+#include <myglm/myglm.h>
+
+/**
+ * Sum of all samples and number of samples of every pixel. The sums are doubles, so thousands of progressive passes
+ * add up without the rounding error of float sums.
+ *
+ * Pixels are stored in a TiledImage of BLOCK_SIZE x BLOCK_SIZE blocks that start on a cache line. A tile whose
+ * corners are multiples of BLOCK_SIZE, like all tiles with an automatic tile size, owns its blocks, so workers adding
+ * to neighboring tiles never write to the same cache line. Other tile sizes are still correct, their border blocks
+ * are just shared.
+ */
+class AccumulationBuffer {
+   public:
+	static constexpr std::size_t BLOCK_SIZE = 8;
+
+   private:
+	struct Pixel {
+		dvec4	 sum;
+		uint32_t count;
+	};
+
+	TiledImage<Pixel, BLOCK_SIZE> pixels;
+
+   public:
+	AccumulationBuffer() = default;
+	AccumulationBuffer(std::size_t width, std::size_t height) { resize(width, height); }
+
+	/// @brief Resizes the buffer, the sums are cleared
+	void resize(std::size_t w, std::size_t h) { pixels.resize(w, h); }
+
+	void clear() { pixels.clear(); }
+
+	inline std::size_t getWidth() const { return pixels.getWidth(); }
+	inline std::size_t getHeight() const { return pixels.getHeight(); }
+
+	/// @brief Adds \a color, the sum of \a samples samples, to pixel (x, y)
+	inline void add(std::size_t x, std::size_t y, const RGBA32F &color, uint32_t samples) {
+		Pixel &p = pixels(x, y);
+		p.sum += dvec4(color);
+		p.count += samples;
+	}
+
+	inline uint32_t count(std::size_t x, std::size_t y) const { return pixels(x, y).count; }
+
+	/// @brief Average of the samples of pixel (x, y), 0 without samples
+	inline RGBA32F mean(std::size_t x, std::size_t y) const {
+		const Pixel &p = pixels(x, y);
+		return RGBA32F(p.sum / double(std::max(p.count, 1u)));
+	}
+
+	/// @brief Writes the average of every pixel to \a out
+	void resolve(Image<RGBA32F> &out) const {
+		out.resize(getWidth(), getHeight());
+		for (std::size_t y = 0; y < getHeight(); ++y) {
+			for (std::size_t x = 0; x < getWidth(); ++x) out(x, y) = mean(x, y);
+		}
+	}
+
+	/// @brief Writes the sample count of every pixel to \a out
+	void resolveCounts(Image<uint32_t> &out) const {
+		out.resize(getWidth(), getHeight());
+		for (std::size_t y = 0; y < getHeight(); ++y) {
+			for (std::size_t x = 0; x < getWidth(); ++x) out(x, y) = count(x, y);
+		}
+	}
+
+	/// @brief Writes the blocks as they are, read() restores them into a buffer of the same size
+	void write(std::ostream &out) const { pixels.write(out); }
+
+	void read(std::istream &in) { pixels.read(in); }
+};
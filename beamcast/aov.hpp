@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <img/image.hpp>
+#include <sample.hpp>
+#include <stats.hpp>
+
+/// What the primary ray of one sample hit, collected while shading to guide the denoiser and for AOV outputs
+struct PixelFeatures {
+	static constexpr uint32_t NO_ID = -1;	  ///< object and material id of the background
+
+	vec3	 normal		= 0;
+	float	 depth		= 0;	 ///< distance along the primary ray, 0 for the background
+	vec3	 albedo		= 0;
+	uint32_t objectId	= NO_ID;
+	uint32_t materialId = NO_ID;
+};
+
+/// Per pixel sums of PixelFeatures over all samples, like the accumulation buffer sums the color
+struct FeatureBuffers {
+	Image<RGBA32F>	normalDepth;	 ///< xyz: shading normal, w: depth
+	Image<RGBA32F>	albedo;			 ///< xyz: albedo, w: number of samples added
+	Image<uint32_t> objectId;		 ///< ids can not be averaged, these are the ids seen by the first sample
+	Image<uint32_t> materialId;
+	Image<RGBA32F>	cost;	  ///< nodes visited, boxes and primitives tested and rays traced, only with BEAMCAST_STATS
+
+	void resize(std::size_t width, std::size_t height) {
+		normalDepth.resize(width, height);
+		albedo.resize(width, height);
+		objectId.resize(width, height);
+		materialId.resize(width, height);
+		if constexpr (stats::ENABLED) cost.resize(width, height);
+		else cost.resize(0, 0);
+	}
+
+	void clear() {
+		std::fill(normalDepth.begin(), normalDepth.end(), RGBA32F(0.f));
+		std::fill(albedo.begin(), albedo.end(), RGBA32F(0.f));
+		std::fill(objectId.begin(), objectId.end(), PixelFeatures::NO_ID);
+		std::fill(materialId.begin(), materialId.end(), PixelFeatures::NO_ID);
+		std::fill(cost.begin(), cost.end(), RGBA32F(0.f));
+	}
+
+	inline void add(std::size_t x, std::size_t y, const PixelFeatures &f) {
+		if (albedo(x, y).w == 0.f) {
+			objectId(x, y)	 = f.objectId;
+			materialId(x, y) = f.materialId;
+		}
+		normalDepth(x, y) += RGBA32F(f.normal, f.depth);
+		albedo(x, y) += RGBA32F(f.albedo, 1.f);
+	}
+};
+
+/// Arbitrary output variables, images of per pixel data written next to the beauty image. The traversal cost
+/// heatmaps (nodes visited, boxes and primitives tested and rays traced per sample) need BEAMCAST_STATS.
+enum class AOV { Depth, Normal, Albedo, ObjectId, MaterialId, SampleCount, Nodes, Boxes, Primitives, Rays };
+
+inline constexpr std::array<std::string_view, 10> AOV_NAMES = {"depth",	"normal",  "albedo", "object",	   "material",
+															   "samples", "nodes",	 "boxes",  "primitives", "rays"};
+
+inline std::string_view aovName(AOV aov) { return AOV_NAMES[std::size_t(aov)]; }
+
+inline bool isCostAOV(AOV aov) { return aov >= AOV::Nodes; }
+
+inline AOV aovFromString(std::string_view name) {
+	auto it = std::ranges::find(AOV_NAMES, name);
+	if (it == AOV_NAMES.end()) throw std::runtime_error("Unknown AOV: " + std::string(name));
+	const AOV aov = AOV(it - AOV_NAMES.begin());
+	if (isCostAOV(aov) && !stats::ENABLED) {
+		throw std::runtime_error("The " + std::string(name) + " AOV needs a build with TRAVERSAL_STATS");
+	}
+	return aov;
+}
+
+/// @brief Names of the channels of \a aov in layered formats, one for every component resolveAOV() fills
+inline std::span<const std::string_view> aovChannels(AOV aov) {
+	static constexpr std::string_view XYZ[] = {"X", "Y", "Z"}, RGB[] = {"R", "G", "B"}, Z[] = {"Z"}, ID[] = {"id"},
+									  COUNT[] = {"count"};
+	switch (aov) {
+		case AOV::Depth: return Z;
+		case AOV::Normal: return XYZ;
+		case AOV::Albedo: return RGB;
+		case AOV::SampleCount:
+		case AOV::Nodes:
+		case AOV::Boxes:
+		case AOV::Primitives:
+		case AOV::Rays: return COUNT;
+		default: return ID;
+	}
+}
+
+/**
+ * @brief Writes the raw values of \a aov to \a out: the average depth, normal and albedo, the object and material
+ * id as a number (-1 for the background), the number of samples or the average traversal cost of a sample, in the
+ * rgb channels.
+ * @param features - primary hit features collected during the render
+ * @param counts - samples per pixel
+ */
+inline void resolveAOV(AOV aov, const FeatureBuffers &features, const Image<uint32_t> &counts, Image<RGBA32F> &out) {
+	out.resize(counts.getWidth(), counts.getHeight());
+	auto id = [](uint32_t id) { return id == PixelFeatures::NO_ID ? -1.f : float(id); };
+	for (std::size_t i = 0; i < out.size(); ++i) {
+		const float samples = std::max(features.albedo[i].w, 1.f);
+		vec3		value;
+		switch (aov) {
+			case AOV::Depth: value = vec3(features.normalDepth[i].w / samples); break;
+			case AOV::Normal: value = features.normalDepth[i].xyz() / samples; break;
+			case AOV::Albedo: value = features.albedo[i].xyz() / samples; break;
+			case AOV::ObjectId: value = vec3(id(features.objectId[i])); break;
+			case AOV::MaterialId: value = vec3(id(features.materialId[i])); break;
+			case AOV::SampleCount: value = vec3(float(counts[i])); break;
+			case AOV::Nodes: value = vec3(features.cost[i].x / samples); break;
+			case AOV::Boxes: value = vec3(features.cost[i].y / samples); break;
+			case AOV::Primitives: value = vec3(features.cost[i].z / samples); break;
+			case AOV::Rays: value = vec3(features.cost[i].w / samples); break;
+		}
+		out[i] = RGBA32F(value, 1.f);
+	}
+}
+
+/// @brief Color of \a t in [0, 1] on a black, blue, red, yellow, white ramp
+inline RGBA32F heatmapColor(float t) {
+	static constexpr std::array<vec3, 5> RAMP = {vec3(0.f, 0.f, 0.f), vec3(0.f, 0.f, 1.f), vec3(1.f, 0.f, 0.f),
+												 vec3(1.f, 1.f, 0.f), vec3(1.f, 1.f, 1.f)};
+	const float		x = std::clamp(t, 0.f, 1.f) * (RAMP.size() - 1);
+	const std::size_t i = std::min<std::size_t>(x, RAMP.size() - 2);
+	const float		f = x - i;
+	return RGBA32F(RAMP[i] * (1.f - f) + RAMP[i + 1] * f, 1.f);
+}
+
+/// @brief Maps the raw values from resolveAOV() to [0, 1] for 8 bit image formats. Depth and sample count are
+/// divided by their maximum, normals are mapped from [-1, 1], every id gets a random color and the traversal cost
+/// is shown as a heatmap scaled to its maximum.
+inline void visualizeAOV(AOV aov, Image<RGBA32F> &img) {
+	switch (aov) {
+		case AOV::Depth:
+		case AOV::SampleCount: {
+			float maxValue = 0.f;
+			for (const auto &p : img) maxValue = std::max(maxValue, p.x);
+			if (maxValue > 0.f) {
+				for (auto &p : img) p = RGBA32F(p._xyz() / maxValue, 1.f);
+			}
+			break;
+		}
+		case AOV::Normal:
+			for (auto &p : img) p = RGBA32F(p._xyz() * 0.5f + 0.5f, 1.f);
+			break;
+		case AOV::ObjectId:
+		case AOV::MaterialId:
+			for (auto &p : img) {
+				if (p.x < 0.f) {
+					p = RGBA32F(0.f, 0.f, 0.f, 1.f);
+					continue;
+				}
+				uint32_t h = pcg_hash(uint32_t(p.x));
+				p		   = RGBA32F(float(h & 0xff) / 255.f, float((h >> 8) & 0xff) / 255.f,
+									 float((h >> 16) & 0xff) / 255.f, 1.f);
+			}
+			break;
+		case AOV::Nodes:
+		case AOV::Boxes:
+		case AOV::Primitives:
+		case AOV::Rays: {
+			float maxValue = 0.f;
+			for (const auto &p : img) maxValue = std::max(maxValue, p.x);
+			for (auto &p : img) p = heatmapColor(maxValue > 0.f ? p.x / maxValue : 0.f);
+			break;
+		}
+		case AOV::Albedo: break;
+	}
+}
@@ -0,0 +1,532 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <img/export.hpp>
+#include <img/mipmap.hpp>
+#include <renderer.hpp>
+#include <scene.hpp>
+#include <texturecache.hpp>
+
+/*
+ * Benchmark suite of the renderer. Every benchmark is called repeatedly for at least --min-time seconds and the
+ * median time of a call over the number of operations it did is reported, so the numbers of different versions can
+ * be compared directly. Results go to a JSON file (bench.json by default):
+ *
+ *	{"version": ..., "threads": ..., "peak_rss_bytes": ..., "results": [
+ *		{"name": "bvh_traversal_incoherent/sphere", "unit": "ray", "ops": 65536, "runs": 40, "ns_per_op": 612.3,
+ *		 "ops_per_sec": 1633186.2, "rays_per_sec": 1633186.2, "memory_bytes": 25821184}, ...]}
+ *
+ * memory_bytes is the heap memory held by the data the benchmark runs on (BVH, scene, image), 0 when nothing is built.
+ *
+ * The synthetic meshes are a UV sphere and a soup of small random triangles, the latter being the harder case for
+ * the BVH. The glTF files and textures of project_scene are used for JSON parsing and texture sampling, the renderer
+ * can not load glTF scenes, so scene loading and rendering use a generated scene of instanced spheres.
+ */
+
+/// heap bytes allocated and not freed by the calling thread, thread local so that counting costs no synchronization
+static thread_local std::ptrdiff_t heapBytes = 0;
+
+void *operator new(std::size_t size) {
+	void *ptr = std::malloc(size);
+	if (!ptr) throw std::bad_alloc();
+	heapBytes += malloc_usable_size(ptr);
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+	heapBytes -= malloc_usable_size(ptr);
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
+
+namespace {
+
+/// keeps the compiler from optimizing away a value that is otherwise unused
+template <class T>
+inline void keep(const T &value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline float random01(uint32_t &state) {
+	state = pcg_hash(state);
+	return toUnitFloat(state);
+}
+
+inline vec3 randomInBall(uint32_t &state) {
+	while (true) {
+		vec3 p(random01(state) * 2.f - 1.f, random01(state) * 2.f - 1.f, random01(state) * 2.f - 1.f);
+		if (dot(p, p) <= 1.f) return p;
+	}
+}
+
+/// heap memory held by the result of \a func, which has to allocate on the calling thread
+template <class F>
+auto measureMemory(std::size_t &bytes, F &&func) {
+	const std::ptrdiff_t before = heapBytes;
+	auto				 result = func();
+	bytes						= std::max<std::ptrdiff_t>(heapBytes - before, 0);
+	return result;
+}
+
+std::size_t peakResidentBytes() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return std::size_t(usage.ru_maxrss) * 1024;
+}
+
+struct Settings {
+	double		min_time  = 0.5;	 ///< seconds every benchmark runs for
+	std::size_t triangles = 200000;	 ///< size of the synthetic meshes
+	int			threads	  = std::thread::hardware_concurrency();
+	int			spp		  = 4;
+	std::string filter;				 ///< only benchmarks whose name contains it run
+	std::string output = "bench.json";
+	std::filesystem::path assets = BEAMCAST_ASSETS;
+};
+
+struct Result {
+	std::string name;
+	std::string unit;	  ///< what one operation is
+	std::size_t ops;	  ///< operations per call
+	std::size_t runs;	  ///< calls measured
+	double		nsPerOp;
+	std::size_t memory;
+};
+
+class Bench {
+	const Settings	   &settings;
+	std::vector<Result> results;
+
+   public:
+	Bench(const Settings &settings) : settings(settings) {}
+
+	bool enabled(std::string_view name) const { return name.find(settings.filter) != std::string_view::npos; }
+
+	/**
+	 * @brief Times \a func, which returns the number of operations it did. The first call is a warm up, the median
+	 * of the following calls is recorded.
+	 * @param memory - bytes held by the data \a func works on
+	 */
+	template <class F>
+	void run(const std::string &name, const std::string &unit, F &&func, std::size_t memory = 0) {
+		if (!enabled(name)) return;
+		using clock = std::chrono::steady_clock;
+
+		const std::size_t	ops = func();
+		std::vector<double> times;
+		const auto			start = clock::now();
+		while (times.size() < 3 || std::chrono::duration<double>(clock::now() - start).count() < settings.min_time) {
+			const auto begin = clock::now();
+			keep(func());
+			times.push_back(std::chrono::duration<double, std::nano>(clock::now() - begin).count());
+		}
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		const double nsPerOp = times[times.size() / 2] / std::max<std::size_t>(ops, 1);
+
+		dbLog(dbg::LOG_INFO, name, ": ", nsPerOp, " ns/", unit, ", ", 1e9 / nsPerOp, " ", unit, "s/s");
+		results.push_back({name, unit, ops, times.size(), nsPerOp, memory});
+	}
+
+	void write(std::ostream &out) const {
+		out << "{\n";
+		out << "\t\"version\": \"" << BEAMCAST_VERSION << "\",\n";
+		out << "\t\"compiler\": \"" << __VERSION__ << "\",\n";
+#ifdef MYGLM_PRECISE_MATH
+		out << "\t\"precise_math\": true,\n";
+#else
+		out << "\t\"precise_math\": false,\n";
+#endif
+		out << "\t\"threads\": " << settings.threads << ",\n";
+		out << "\t\"min_time\": " << settings.min_time << ",\n";
+		out << "\t\"peak_rss_bytes\": " << peakResidentBytes() << ",\n";
+		out << "\t\"results\": [";
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			const auto &r = results[i];
+			out << (i ? ",\n\t\t" : "\n\t\t");
+			out << std::format(R"({{"name": "{}", "unit": "{}", "ops": {}, "runs": {}, "ns_per_op": {:.3f}, )", r.name,
+							   r.unit, r.ops, r.runs, r.nsPerOp);
+			out << std::format(R"("ops_per_sec": {:.1f}, )", 1e9 / r.nsPerOp);
+			if (r.unit == "ray") out << std::format(R"("rays_per_sec": {:.1f}, )", 1e9 / r.nsPerOp);
+			out << std::format(R"("memory_bytes": {}}})", r.memory);
+		}
+		out << "\n\t]\n}\n";
+	}
+};
+
+struct MeshData {
+	std::vector<vec3>  vertices;
+	std::vector<vec3>  uvs;
+	std::vector<ivec3> indices;
+};
+
+/// UV sphere of radius 1 with about \a triangles triangles, without the degenerate ones at the poles
+MeshData makeSphere(std::size_t triangles) {
+	const int stacks = std::max(2, int(std::sqrt(triangles / 4.f))), slices = 2 * stacks;
+	MeshData  mesh;
+	for (int i = 0; i <= stacks; ++i) {
+		for (int j = 0; j <= slices; ++j) {
+			const float u = float(j) / slices, v = float(i) / stacks;
+			const float phi = u * 2.f * M_PI, theta = v * M_PI;
+			mesh.vertices.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			mesh.uvs.emplace_back(u, v, 0.f);
+		}
+	}
+	for (int i = 0; i < stacks; ++i) {
+		for (int j = 0; j < slices; ++j) {
+			const int a = i * (slices + 1) + j, b = a + slices + 1;
+			if (i > 0) mesh.indices.emplace_back(a, a + 1, b);
+			if (i < stacks - 1) mesh.indices.emplace_back(a + 1, b + 1, b);
+		}
+	}
+	return mesh;
+}
+
+/// \a triangles small randomly oriented triangles in the unit ball
+MeshData makeSoup(std::size_t triangles, uint32_t seed) {
+	MeshData mesh;
+	for (std::size_t i = 0; i < triangles; ++i) {
+		const vec3 center = randomInBall(seed);
+		for (int k = 0; k < 3; ++k) {
+			mesh.vertices.push_back(center + randomInBall(seed) * 0.05f);
+			mesh.uvs.emplace_back(random01(seed), random01(seed), 0.f);
+		}
+		mesh.indices.emplace_back(3 * i, 3 * i + 1, 3 * i + 2);
+	}
+	return mesh;
+}
+
+std::vector<Triangle> toTriangles(const MeshData &mesh) {
+	std::vector<Triangle> triangles;
+	triangles.reserve(mesh.indices.size());
+	for (const auto &[i, index] : std::views::enumerate(mesh.indices)) {
+		triangles.emplace_back(mesh.vertices[index.x], mesh.vertices[index.y], mesh.vertices[index.z], i);
+	}
+	return triangles;
+}
+
+ygl::bvh::TriangleBVH buildBVH(const std::vector<Triangle> &triangles) {
+	ygl::bvh::TriangleBVH bvh;
+	for (const auto &triangle : triangles) bvh.addPrimitive(triangle);
+	bvh.build(ygl::bvh::TriangleBVH::Purpose::Mesh);
+	return bvh;
+}
+
+/// rays from a sphere of radius 3 to random points in the unit ball, in no particular order
+std::vector<Ray> incoherentRays(std::size_t count, uint32_t seed) {
+	std::vector<Ray> rays;
+	for (std::size_t i = 0; i < count; ++i) {
+		const vec3 origin = normalize(randomInBall(seed)) * 3.f;
+		rays.emplace_back(origin, normalize(randomInBall(seed) - origin));
+	}
+	return rays;
+}
+
+/// primary rays of a camera at distance 3 looking at the unit ball, in scanline order
+std::vector<Ray> coherentRays(int size) {
+	mat4 view = identity<float, 4>();
+	view[2][3] = 3.f;
+	const Camera	 camera(view, toRadians(45.f), ivec2(size, size));
+	std::vector<Ray> rays;
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			Sampler sampler(SamplerType::Random, uvec2(x, y), 0, 0);
+			rays.push_back(camera.generate_ray(ivec2(x, y), sampler));
+		}
+	}
+	return rays;
+}
+
+/// flattens the vectors into one JSON array, like the scene files store them
+template <class T, std::size_t N>
+std::string jsonArray(const std::vector<vec<T, N>> &values) {
+	std::string result = "[";
+	for (const auto &v : values) {
+		for (std::size_t k = 0; k < N; ++k) result += std::format("{}, ", v[k]);
+	}
+	if (result.size() > 1) result.resize(result.size() - 2);
+	return result + "]";
+}
+
+/// writes a scene of a ground plane and three instances of a sphere of \a triangles triangles
+void writeScene(const std::filesystem::path &path, std::size_t triangles) {
+	const MeshData sphere = makeSphere(triangles);
+	std::ofstream  out(path);
+	if (!out) { throw std::runtime_error("Failed to open file for writing: " + path.string()); }
+	out << R"({"settings": {"background_color": [0.6, 0.7, 0.8], "image_settings": {"width": 320, "height": 180}},)"
+		<< R"("camera": {"fov": 60, "matrix": [1, 0, 0, 0, 1, 0, 0, 0, 1], "position": [0, 1, 6]},)"
+		<< R"("lights": [{"position": [2, 6, 4], "intensity": 800}],)"
+		<< R"("textures": [{"name": "checker", "type": "checker", "color_A": [0.9, 0.9, 0.9], "color_B": [0.2, 0.2, 0.2], "square_size": 0.1}],)"
+		<< R"("materials": [{"type": "diffuse", "albedo": "checker", "smooth_shading": false},)"
+		<< R"({"type": "diffuse", "albedo": [0.8, 0.3, 0.3]}, {"type": "reflective", "albedo": [0.9, 0.9, 0.9]},)"
+		<< R"({"type": "refractive", "ior": 1.5}],)";
+	out << R"("meshes": [{"vertices": )" << jsonArray(sphere.vertices) << R"(, "uvs": )" << jsonArray(sphere.uvs)
+		<< R"(, "triangles": )" << jsonArray(sphere.indices) << "}],";
+	out << R"("objects": [{"vertices": [-20, -1, -20, 20, -1, -20, 20, -1, 20, -20, -1, 20], "triangles": [0, 2, 1, 0, 3, 2],)"
+		<< R"("uvs": [0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0], "material_index": 0})";
+	for (int i = 0; i < 3; ++i) {
+		out << std::format(R"(, {{"ref": 0, "material_index": {}, "transform": [1, 0, 0, {}, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1]}})",
+						   i + 1, 2.2f * (i - 1));
+	}
+	out << "]}";
+}
+
+void bvhBenchmarks(Bench &bench, const Settings &settings) {
+	if (!bench.enabled("bvh") && !bench.enabled("triangle")) return;
+	const std::pair<std::string, MeshData> meshes[] = {{"sphere", makeSphere(settings.triangles)},
+													   {"soup", makeSoup(settings.triangles, 1)}};
+	const auto incoherent = incoherentRays(1 << 16, 2);
+	const auto coherent	  = coherentRays(256);
+
+	for (const auto &[name, mesh] : meshes) {
+		const auto triangles = toTriangles(mesh);
+
+		std::size_t memory;
+		const auto	bvh = measureMemory(memory, [&] { return buildBVH(triangles); });
+
+		bench.run("bvh_build/" + name, "triangle", [&] {
+			keep(buildBVH(triangles).isBuilt());
+			return triangles.size();
+		}, memory);
+
+		auto trace = [&](const std::vector<Ray> &rays) {
+			return [&] {
+				std::size_t hits = 0;
+				for (const auto &ray : rays) {
+					RayHit hit;
+					hits += bvh.intersect(ray, 0.0001f, FLT_MAX, hit);
+				}
+				keep(hits);
+				return rays.size();
+			};
+		};
+		bench.run("bvh_traversal_incoherent/" + name, "ray", trace(incoherent), memory);
+		bench.run("bvh_traversal_coherent/" + name, "ray", trace(coherent), memory);
+	}
+
+	// every ray is tested against every triangle, about one in a thousand tests hits
+	const auto triangles = toTriangles(makeSoup(1024, 3));
+	const auto rays		 = incoherentRays(1024, 4);
+	bench.run("triangle_intersection", "test", [&] {
+		std::size_t hits = 0;
+		for (const auto &ray : rays) {
+			for (const auto &triangle : triangles) {
+				RayHit hit;
+				hits += triangle.intersect(ray, 0.0001f, FLT_MAX, hit);
+			}
+		}
+		keep(hits);
+		return rays.size() * triangles.size();
+	});
+}
+
+void sceneBenchmarks(Bench &bench, const Settings &settings, const std::filesystem::path &directory) {
+	if (!bench.enabled("json") && !bench.enabled("scene") && !bench.enabled("render")) return;
+	const auto scenePath = directory / "scene.json";
+	writeScene(scenePath, settings.triangles / 4);
+
+	std::vector<std::pair<std::string, std::filesystem::path>> files = {{"synthetic_scene", scenePath}};
+	for (const auto &name : {"shaderball", "tree"}) {
+		const auto path = settings.assets / name / "scene.gltf";
+		if (std::filesystem::exists(path)) files.emplace_back(name, path);
+		else dbLog(dbg::LOG_WARNING, "Skipping ", path, ", the file does not exist");
+	}
+	for (const auto &[name, path] : files) {
+		const auto	bytes = std::filesystem::file_size(path);
+		std::size_t memory;
+		measureMemory(memory, [&] { return JSONFromFile(path.string()); });
+		bench.run("json_parse/" + name, "byte", [&] {
+			keep(JSONFromFile(path.string()).get());
+			return bytes;
+		}, memory);
+	}
+
+	if (!bench.enabled("scene") && !bench.enabled("render")) return;
+	std::size_t memory;
+	const auto	scene = measureMemory(memory, [&] { return std::make_unique<Scene>(scenePath.string()); });
+	bench.run("scene_load/synthetic_scene", "scene", [&] {
+		Scene loaded(scenePath.string());
+		keep(loaded.getObjects().size());
+		return 1;
+	}, memory);
+
+	Renderer renderer(*scene, 1.f, settings.threads, settings.spp);
+	bench.run("render/synthetic_scene", "ray", [&] {
+		renderer.render();
+		return renderer.getRayCount();
+	});
+}
+
+void imageBenchmarks(Bench &bench, const Settings &settings) {
+	if (!bench.enabled("texture") && !bench.enabled("png")) return;
+	std::vector<std::pair<std::string, Image<RGB32F>>> textures;
+	{
+		uint32_t	  seed = 5;
+		Image<RGB32F> noise(2048, 2048);
+		for (auto &texel : noise) texel = RGB32F(random01(seed), random01(seed), random01(seed));
+		textures.emplace_back("noise_2048", std::move(noise));
+	}
+	for (const auto &file : {"tree/textures/material_baseColor.png", "tree/textures/Vegetation_Bark_Maple_1_baseColor.jpeg"}) {
+		const auto path = settings.assets / file;
+		if (!std::filesystem::exists(path)) {
+			dbLog(dbg::LOG_WARNING, "Skipping ", path, ", the file does not exist");
+			continue;
+		}
+		textures.emplace_back(path.stem().string(), Image<RGB32F>());
+		textures.back().second.loadFromFile(path.string());
+	}
+
+	uint32_t		  seed = 6;
+	std::vector<vec2> uvs(1 << 16);
+	for (auto &uv : uvs) uv = vec2(random01(seed), random01(seed));
+	for (const auto &[name, texture] : textures) {
+		bench.run("texture_sample/" + name, "sample", [&] {
+			RGB32F sum = 0.f;
+			for (const auto &uv : uvs) sum += texture.sample(uv);
+			keep(sum);
+			return uvs.size();
+		}, texture.size() * sizeof(RGB32F));
+
+		const MipMap mipmap(texture);
+		bench.run("texture_mipmap/" + name, "texel", [&] {
+			MipMap built(texture);
+			keep(built.levelCount());
+			return texture.size();
+		});
+		// a footprint of about 3 texels, between two mip levels
+		const float footprint = 3.f / std::sqrt(float(texture.size()));
+		for (const auto &[filterName, filter] : {std::pair{"nearest", TextureFilter::Nearest},
+												  std::pair{"bilinear", TextureFilter::Bilinear},
+												  std::pair{"trilinear", TextureFilter::Trilinear}}) {
+			bench.run("texture_sample/" + name + "/" + filterName, "sample", [&] {
+				RGBA32F sum = 0.f;
+				for (const auto &uv : uvs) sum += mipmap.sample(uv, footprint, filter);
+				keep(sum);
+				return uvs.size();
+			}, mipmap.memory());
+		}
+
+		// 256x256 pixels looking at the full size texels at an angle, in scanline order like the pixels of a tile
+		std::vector<vec2> coherent;
+		const float		  texel = 1.f / std::sqrt(float(texture.size()));
+		const vec2		  dx = vec2(0.866f, 0.5f) * texel, dy = vec2(-0.5f, 0.866f) * texel;
+		for (int y = -128; y < 128; ++y) {
+			for (int x = -128; x < 128; ++x) coherent.push_back(vec2(0.5f) + dx * float(x) + dy * float(y));
+		}
+		bench.run("texture_sample/" + name + "/coherent", "sample", [&] {
+			RGB32F sum = 0.f;
+			for (const auto &uv : coherent) sum += texture.sample(uv);
+			keep(sum);
+			return coherent.size();
+		}, texture.size() * sizeof(RGB32F));
+		bench.run("texture_sample/" + name + "/trilinear_coherent", "sample", [&] {
+			RGBA32F sum = 0.f;
+			for (const auto &uv : coherent) sum += mipmap.sample(uv, texel, TextureFilter::Trilinear);
+			keep(sum);
+			return coherent.size();
+		}, mipmap.memory());
+
+		// the same samples through the texture cache, with all pages resident and with the smallest budget
+		const auto tiledPath = std::filesystem::temp_directory_path() / ("beamcast-bench-" + name + ".btx");
+		tiledfile::write(mipmap, tiledPath, tiledfile::Header{});
+		for (const auto &[budgetName, budget] : {std::pair{"resident", mipmap.memory() * 2}, std::pair{"thrashing", std::size_t(0)}}) {
+			TextureCache			  cache(budget);
+			const TextureCache::File tiled(cache, tiledPath);
+			for (const auto &uvSet : {std::pair{"", &uvs}, std::pair{"_coherent", &coherent}}) {
+				const float filterWidth = uvSet.second == &uvs ? footprint : texel;
+				bench.run("texture_cache/" + name + "/" + budgetName + uvSet.first, "sample", [&] {
+					RGBA32F sum = 0.f;
+					for (const auto &uv : *uvSet.second) {
+						RGBA32F c;
+						_mm_storeu_ps(c.data, tiled.sampleSSE(uv, filterWidth, TextureFilter::Trilinear));
+						sum += c;
+					}
+					keep(sum);
+					return uvSet.second->size();
+				}, cache.budget());
+			}
+			cache.logStatistics();
+		}
+		std::filesystem::remove(tiledPath);
+	}
+
+	// a smooth gradient with some noise compresses like a rendered frame
+	Image<RGBA32F> frame(1920, 1080);
+	for (std::size_t y = 0; y < frame.getHeight(); ++y) {
+		for (std::size_t x = 0; x < frame.getWidth(); ++x) {
+			const float noise = random01(seed) * 0.05f;
+			frame(x, y) = RGBA32F(float(x) / frame.getWidth() + noise, float(y) / frame.getHeight(), 0.5f + noise, 1.f);
+		}
+	}
+	bench.run("png_export/1920x1080", "pixel", [&] {
+		// encoded to memory, the file system would only add noise
+		std::ostringstream out;
+		PngWriter().write(frame, out);
+		keep(out.tellp());
+		return frame.size();
+	}, frame.size() * sizeof(RGBA32F));
+}
+
+}	  // namespace
+
+int main(int argc, char **argv) {
+	Settings settings;
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string_view arg = argv[i];
+			auto			 eq	 = arg.find('=');
+			if (!arg.starts_with("--") || eq == std::string_view::npos) {
+				throw std::runtime_error("Unknown argument: " + std::string(arg));
+			}
+			const auto name = arg.substr(2, eq - 2);
+			const auto value = std::string(arg.substr(eq + 1));
+			if (name == "out") settings.output = value;
+			else if (name == "filter") settings.filter = value;
+			else if (name == "assets") settings.assets = value;
+			else if (name == "min-time") settings.min_time = std::stod(value);
+			else if (name == "triangles") settings.triangles = std::stoul(value);
+			else if (name == "threads") settings.threads = std::stoi(value);
+			else if (name == "spp") settings.spp = std::stoi(value);
+			else throw std::runtime_error("Unknown option: --" + std::string(name));
+		}
+	} catch (const std::exception &e) {
+		dbLog(dbg::LOG_ERROR, e.what());
+		dbLog(dbg::LOG_ERROR, "Usage: ", argv[0], " [--out=<file|->] [--filter=<substring>] [--min-time=<seconds>]");
+		dbLog(dbg::LOG_ERROR, "         [--triangles=<n>] [--threads=<n>] [--spp=<n>] [--assets=<project_scene dir>]");
+		return 1;
+	}
+
+	const auto directory = std::filesystem::temp_directory_path() / std::format("beamcast_bench_{}", getpid());
+	std::filesystem::create_directories(directory);
+
+	Bench bench(settings);
+	try {
+		bvhBenchmarks(bench, settings);
+		sceneBenchmarks(bench, settings, directory);
+		imageBenchmarks(bench, settings);
+	} catch (const std::exception &e) {
+		dbLog(dbg::LOG_ERROR, "Benchmark failed: ", e.what());
+		std::filesystem::remove_all(directory);
+		return 1;
+	}
+	std::filesystem::remove_all(directory);
+
+	if (settings.output == "-") {
+		bench.write(std::cout);
+	} else {
+		std::ofstream out(settings.output);
+		if (!out) {
+			dbLog(dbg::LOG_ERROR, "Failed to open file for writing: ", settings.output);
+			return 1;
+		}
+		bench.write(out);
+		dbLog(dbg::LOG_INFO, "Results written to ", settings.output);
+	}
+}
@@ -20,6 +20,9 @@
 #include <data.hpp>
 #include <intersectable.hpp>
 #include <log.hpp>
+#include <perf.hpp>
+#include <stats.hpp>
+#include <trace.hpp>
 
 namespace ygl {
 /**
@@ -307,9 +310,10 @@ template <class Element>
 void BVHTree<Element>::build(Super::Purpose purpose) {
 	static_cast<void>(purpose);
 	// purpose is ignored. what works best for triangles seems to also work best for objects
-	printf("Building BVH tree with %d primitives... \n", int(allPrimitives.size()));
-	fflush(stdout);
-	Timer timer;
+	dbLog(dbg::LOG_INFO, "Building BVH tree with ", allPrimitives.size(), " primitives...");
+	Timer		timer;
+	trace::Zone zone("BVH build", "primitives", allPrimitives.size());
+	perf::Scope scope(perf::Phase::Build);
 
 	primitivesCount = allPrimitives.size();
 
@@ -362,6 +366,7 @@ bool BVHTree<Element>::intersect(long unsigned int nodeIndex, const Ray &ray, fl
 								 RayHit &intersection, const IntersectionAccelerator<Element>::Filter &f) const {
 	bool			hasHit = false;
 	const FastNode *node   = &(fastNodes[nodeIndex]);
+	stats::NodeVisit visit;
 
 	if (node->isLeaf()) {
 		// dbLog(dbg::LOG_DEBUG, "Intersecting leaf ", nodeIndex, " with ", node->primitives, " primitives");
@@ -370,7 +375,9 @@ bool BVHTree<Element>::intersect(long unsigned int nodeIndex, const Ray &ray, fl
 		for (int i = 0; i < leafSize && allPrimitives[node->primitives + i]; i++) {
 			const auto &prim = allPrimitives[node->primitives + i];
 			assert(prim && "Primitive pointer is null in BVH tree");
-			if (f(prim.get()) && prim->intersect(ray, tMin, tMax, intersection)) {
+			if (!f(prim.get())) continue;
+			stats::countPrimitive();
+			if (prim->intersect(ray, tMin, tMax, intersection)) {
 				tMax					 = intersection.t;
 				hasHit					 = true;
 				intersection.objectIndex = node->primitives + i;
@@ -399,6 +406,7 @@ bool BVHTree<Element>::intersect(long unsigned int nodeIndex, const Ray &ray, fl
 		long unsigned int childIndices[2]  = {nodeIndex + 1, node->right};
 		bool			  testIntersect[2] = {fastNodes[childIndices[0]].box.testIntersect(ray, dist[0]),
 											  fastNodes[childIndices[1]].box.testIntersect(ray, dist[1])};
+		stats::countBoxes(2);
 
 		int direction = ray.direction[node->splitAxis] > 0.f;
 
@@ -424,7 +432,9 @@ bool BVHTree<Element>::intersect(long unsigned int nodeIndex, const Ray &ray, fl
 template <class Element>
 bool BVHTree<Element>::intersect(const Ray &ray, float tMin, float tMax, RayHit &intersection,
 								 const IntersectionAccelerator<Element>::Filter &f) const {
-	if (!allPrimitives.empty() && fastNodes[0].box.testIntersect(ray)) {
+	if (allPrimitives.empty()) return false;
+	stats::countBoxes(1);
+	if (fastNodes[0].box.testIntersect(ray)) {
 		return intersect(0, ray, tMin, tMax, intersection, f);
 	} else return false;
 }
@@ -71,10 +71,11 @@ class Camera {
 		aspect = (float)resolution.y / (float)resolution.x;
 	}
 
-	Ray generate_ray(ivec2 pixel, uint32_t &seed) const {
+	Ray generate_ray(ivec2 pixel, Sampler &sampler) const {
 		pixel.y	 = resolution.y - pixel.y - 1;	   // Flip Y coordinate for image coordinates
-		vec2 ndc = vec2(((float)pixel.x + randomFloat(seed)) / (float)resolution.x,
-						((float)pixel.y + randomFloat(seed)) / (float)resolution.y);
+		vec2 jitter = sampler.get2D();
+		vec2 ndc	= vec2(((float)pixel.x + jitter.x) / (float)resolution.x,
+						   ((float)pixel.y + jitter.y) / (float)resolution.y);
 
 		vec2 screen = ndc * 2.0f - 1.0f;
 
@@ -83,7 +84,10 @@ class Camera {
 		vec3 direction = normalize(vec3(screen.x * tan(fov / 2.0f), screen.y * tan(fov / 2.0f), -1.0f));
 		direction	   = (view_matrix * vec4(direction, 0.0f)).xyz();
 		auto t		   = Transpose(view_matrix)[3]._xyz();
-		return Ray(t, direction);
+		Ray	 ray(t, direction);
+		// the cone starts as a point at the camera and is one pixel wide at distance 1
+		ray.coneSpread = 2.0f * tan(fov / 2.0f) / (float)resolution.x;
+		return ray;
 	}
 
 	void setFrame(int frame) {
@@ -13,10 +13,21 @@ struct Ray {
 		Primary,
 		Shadow,
 	} type = Type::Primary;
+	// a cone around the ray that covers the pixel it was traced for, used to filter textures
+	float coneWidth	 = 0;	 ///< width at the origin
+	float coneSpread = 0;	 ///< growth of the width per unit of distance, 0 without a cone
 
 	Ray(const vec3& o, const vec3& d, Type t = Primary, const vec3 &attenuation = 1.0f) : origin(o), direction(d), attenuation(attenuation), type(t) {}
 
 	inline constexpr auto at(float t) const { return origin + direction * t; }
+
+	/// @brief Continues the cone of \a parent from a hit where it is \a width wide, the curvature of the surface
+	/// is ignored
+	inline Ray& continueCone(const Ray& parent, float width) {
+		coneWidth  = width;
+		coneSpread = parent.coneSpread;
+		return *this;
+	}
 };
 
 struct RayHit {
@@ -28,6 +39,8 @@ struct RayHit {
 	unsigned int objectIndex = -1;
 	unsigned int depth		 = 0;
 	vec3		 texCoords	 = 0;
+	float		 coneWidth	 = 0;	 ///< width of the ray cone at pos
+	float		 uvFootprint = 0;	 ///< width of the ray cone in texture coordinates, 0 without a cone
 };
 
 /**
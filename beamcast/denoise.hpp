@@ -0,0 +1,149 @@
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <any>
+#include <cmath>
+
+#include <aov.hpp>
+#include <img/image.hpp>
+#include <perf.hpp>
+#include <threading.hpp>
+#include <trace.hpp>
+
+/// Settings for Denoiser, the sigmas control how different two pixels may be and still be blended
+struct DenoiseSettings {
+	int	  iterations  = 5;		  ///< the filter radius doubles with every iteration, 5 reach 62 pixels
+	float colorSigma  = 0.75f;	  ///< halved every iteration, so later passes only smooth remaining noise
+	float normalSigma = 0.2f;
+	float depthSigma  = 0.05f;	  ///< relative to the depth of the center pixel
+	float albedoSigma = 0.1f;
+};
+
+/**
+ * Edge avoiding à-trous wavelet filter.
+ * Dammertz et al., "Edge-Avoiding À-Trous Wavelet Transform for fast Global Illumination Filtering", HPG 2010
+ *
+ * Every iteration applies a 5x5 B3 spline kernel whose taps are 2^i pixels apart. Each tap is weighted by how
+ * similar its color, normal, depth and albedo are to the center pixel, so edges and texture detail survive
+ * while the noise is averaged away. The color is divided by the albedo before filtering and multiplied back
+ * after it, so textures do not need to be preserved by the color weight.
+ *
+ * A pixel is one RGBA32F, so all per tap math runs on one SSE register. Rows are split into bands that run
+ * on the thread pool.
+ */
+class Denoiser {
+	static constexpr int	  BAND_HEIGHT = 16;
+	static constexpr float	  KERNEL[5]	  = {1.f / 16, 1.f / 4, 3.f / 8, 1.f / 4, 1.f / 16};
+	static constexpr float	  MIN_ALBEDO  = 1e-3f;
+
+	struct Pass {
+		Image<RGBA32F>		 *in;
+		Image<RGBA32F>		 *out;
+		const Image<RGBA32F> *normalDepth;
+		const Image<RGBA32F> *albedo;
+		int					  step;
+		__m128				  invPhi;	  ///< 1 / sigma^2 of color, normal, depth and albedo
+	};
+
+	static inline __m128 load(const RGBA32F &v) { return _mm_loadu_ps(v.data); }
+
+	static void filterRows(const Pass &pass, int yBegin, int yEnd) {
+		const int w = pass.in->getWidth(), h = pass.in->getHeight();
+		for (int y = yBegin; y < yEnd; ++y) {
+			for (int x = 0; x < w; ++x) {
+				const __m128 c = load((*pass.in)(x, y));
+				const __m128 n = load((*pass.normalDepth)(x, y));
+				const __m128 a = load((*pass.albedo)(x, y));
+				// depth difference relative to the center depth, 0 for the background
+				const float invDepth = 1.f / std::max((*pass.normalDepth)(x, y).w, 1e-3f);
+
+				__m128 sum	= _mm_setzero_ps();
+				__m128 wsum = _mm_setzero_ps();
+				for (int j = 0; j < 5; ++j) {
+					const int qy = y + (j - 2) * pass.step;
+					if (qy < 0 || qy >= h) continue;
+					for (int i = 0; i < 5; ++i) {
+						const int qx = x + (i - 2) * pass.step;
+						if (qx < 0 || qx >= w) continue;
+
+						const __m128 cq = load((*pass.in)(qx, qy));
+						const __m128 dc = _mm_sub_ps(c, cq);
+						const __m128 dn = _mm_sub_ps(n, load((*pass.normalDepth)(qx, qy)));
+						const __m128 da = _mm_sub_ps(a, load((*pass.albedo)(qx, qy)));
+
+						// squared distances of color, normal, depth and albedo in one register
+						const float dz	 = _mm_cvtss_f32(_mm_shuffle_ps(dn, dn, 3)) * invDepth;
+						__m128		dist = _mm_set_ps(_mm_cvtss_f32(_mm_dp_ps(da, da, 0x71)), dz * dz,
+													  _mm_cvtss_f32(_mm_dp_ps(dn, dn, 0x71)),
+													  _mm_cvtss_f32(_mm_dp_ps(dc, dc, 0x71)));
+						dist			 = _mm_mul_ps(dist, pass.invPhi);
+						dist			 = _mm_hadd_ps(dist, dist);
+						dist			 = _mm_hadd_ps(dist, dist);
+
+						const float	 weight = KERNEL[i] * KERNEL[j] * std::exp(-_mm_cvtss_f32(dist));
+						const __m128 wv		= _mm_set1_ps(weight);
+						sum					= _mm_add_ps(sum, _mm_mul_ps(wv, cq));
+						wsum				= _mm_add_ps(wsum, wv);
+					}
+				}
+				// the center tap always has weight KERNEL[2]^2, wsum is never 0
+				_mm_storeu_ps((*pass.out)(x, y).data, _mm_div_ps(sum, wsum));
+			}
+		}
+	}
+
+	static void run(OneShotThreadPool &pool, const Pass &pass) {
+		pool.reset();
+		for (int y = 0; y < int(pass.in->getHeight()); y += BAND_HEIGHT) {
+			pool.addJob(std::any(y), [&pass](const std::any &job) {
+				const int	y = std::any_cast<int>(job);
+				trace::Zone zone("Denoise band", "y", y);
+				perf::Scope scope(perf::Phase::Export);
+				filterRows(pass, y, std::min<int>(y + BAND_HEIGHT, pass.in->getHeight()));
+			});
+		}
+		pool.start();
+		pool.wait();
+	}
+
+   public:
+	/**
+	 * @brief Filters the averaged samples in \a image and writes the result to \a out, which may be \a image
+	 * @param features - feature sums collected alongside the samples
+	 */
+	static void denoise(const Image<RGBA32F> &image, const FeatureBuffers &features, Image<RGBA32F> &out,
+						OneShotThreadPool &pool, const DenoiseSettings &settings) {
+		Timer			   timer;
+		trace::Zone		   zone("Denoise");
+		const std::size_t w = image.getWidth(), h = image.getHeight();
+		Image<RGBA32F>	   color(w, h), scratch(w, h), normalDepth(w, h), albedo(w, h);
+
+		for (std::size_t i = 0; i < image.size(); ++i) {
+			const float featureCount = std::max(features.albedo[i].w, 1.f);
+			normalDepth[i]			 = features.normalDepth[i] / featureCount;
+			albedo[i]				 = RGBA32F(features.albedo[i]._xyz() / featureCount, 0.f);
+			// filter the lighting only, the albedo is multiplied back afterwards
+			const RGBA32F c = image[i];
+			color[i]		= RGBA32F(c._xyz() / max(albedo[i]._xyz(), vec3(float(MIN_ALBEDO))), c.w);
+		}
+
+		Pass pass{&color, &scratch, &normalDepth, &albedo, 1, {}};
+		for (int i = 0; i < settings.iterations; ++i) {
+			const float colorSigma = settings.colorSigma * std::exp2(-float(i));
+			pass.invPhi = _mm_set_ps(1.f / (settings.albedoSigma * settings.albedoSigma),
+									 1.f / (settings.depthSigma * settings.depthSigma),
+									 1.f / (settings.normalSigma * settings.normalSigma),
+									 1.f / (colorSigma * colorSigma));
+			run(pool, pass);
+			std::swap(pass.in, pass.out);
+			pass.step *= 2;
+		}
+
+		const Image<RGBA32F> &result = *pass.in;
+		for (std::size_t i = 0; i < out.size(); ++i) {
+			out[i] = RGBA32F(result[i]._xyz() * max(albedo[i]._xyz(), vec3(float(MIN_ALBEDO))), result[i].w);
+		}
+		dbLog(dbg::LOG_DEBUG, "Denoised in ", timer.elapsed<std::chrono::milliseconds>(), " ms");
+	}
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <string_view>
+
+/// 64 bit FNV-1a, for names and checks that are stored on disk: stable across runs and builds unlike std::hash
+namespace fnv1a {
+inline constexpr uint64_t OFFSET = 0xcbf29ce484222325ull;
+inline constexpr uint64_t PRIME	 = 0x100000001b3ull;
+
+/// @param hash - the hash of the bytes before \a bytes, to hash several pieces as one
+inline constexpr uint64_t hash(std::string_view bytes, uint64_t hash = OFFSET) {
+	for (char c : bytes) hash = (hash ^ uint8_t(c)) * PRIME;
+	return hash;
+}
+
+/// @brief Hash of everything left in \a in
+inline uint64_t hash(std::istream &in, uint64_t hash = OFFSET) {
+	for (auto it = std::istreambuf_iterator<char>(in); it != std::istreambuf_iterator<char>(); ++it) {
+		hash = (hash ^ uint8_t(*it)) * PRIME;
+	}
+	return hash;
+}
+}	  // namespace fnv1a
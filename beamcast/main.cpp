@@ -1,10 +1,17 @@
 #include <iostream>
 #include <fenv.h>
+#include <csignal>
+#include <limits>
+#include <numeric>
+#include <filesystem>
+#include <unordered_map>
 
 #include <img/export.hpp>
+#include <img/video.hpp>
 #include <camera.hpp>
 #include <scene.hpp>
 #include <renderer.hpp>
+#include <trace.hpp>
 
 /*
 
@@ -16,17 +23,95 @@ sectors:			56298 ms
 bvh:				183ms
 */
 
-int main(int argc, char** argv) {
+static Renderer *activeRenderer = nullptr;
+
+/// the first Ctrl+C or SIGTERM finishes the current pass and saves the image or checkpoint, the second one terminates
+static void onInterrupt(int sig) {
+	if (activeRenderer) activeRenderer->requestStop();
+	std::signal(sig, SIG_DFL);
+}
+
+/// parses a named option value, returns false and logs when it is not a valid number or does not fit into \a value
+template <class T>
+static bool parseOption(const std::unordered_map<std::string, std::string> &options, const std::string &name, T &value) {
+	auto it = options.find(name);
+	if (it == options.end()) return true;
+	try {
+		if constexpr (std::is_unsigned_v<T>) {
+			// std::stoull accepts "-1" and wraps it around
+			if (it->second.find('-') != std::string::npos) throw std::invalid_argument("must not be negative");
+			const unsigned long long parsed = std::stoull(it->second);
+			if (parsed > std::numeric_limits<T>::max()) throw std::out_of_range("too large");
+			value = T(parsed);
+		} else if constexpr (std::is_integral_v<T>) {
+			const long long parsed = std::stoll(it->second);
+			if (parsed < std::numeric_limits<T>::min() || parsed > std::numeric_limits<T>::max()) {
+				throw std::out_of_range("out of range");
+			}
+			value = T(parsed);
+		} else value = std::stof(it->second);
+	} catch (const std::exception &e) {
+		dbLog(dbg::LOG_ERROR, "Invalid value for --", name, ": ", e.what());
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv_) {
 	// feenableexcept(FE_INVALID);
+
+	// options of the form --name or --name=value may appear anywhere, everything else is positional
+	std::vector<char *>							 argv;
+	std::unordered_map<std::string, std::string> options;
+	for (int i = 0; i < argc; ++i) {
+		std::string_view arg = argv_[i];
+		if (i > 0 && arg.starts_with("--")) {
+			auto eq = arg.find('=');
+			if (eq == std::string_view::npos) options[std::string(arg.substr(2))] = "";
+			else options[std::string(arg.substr(2, eq - 2))] = std::string(arg.substr(eq + 1));
+		} else argv.push_back(argv_[i]);
+	}
+	argc = argv.size();
+
 	if (argc <= 1) {
 		dbLog(dbg::LOG_ERROR, "No scene file provided.");
 		dbLog(dbg::LOG_ERROR, "Usage: ", argv[0], " <scene_file> [resolution_scale] [samples_per_pixel] [a: render entire animation] [num_threads]");
+		dbLog(dbg::LOG_ERROR, "Options: --progressive --time-limit=<seconds> --preview=<seconds> --preview-file=<file>");
+		dbLog(dbg::LOG_ERROR, "         --time-budget=<seconds> --checkpoint=<seconds>");
+		dbLog(dbg::LOG_ERROR, "         --tile-size=<pixels> --tile-order=<hilbert|morton|scanline>");
+		dbLog(dbg::LOG_ERROR, "         --sampler=<sobol|bluenoise|random> --denoise --denoise-iterations=<n>");
+		dbLog(dbg::LOG_ERROR, "         --aov=<depth,normal,albedo,object,material,samples>");
+		dbLog(dbg::LOG_ERROR, "         --aov=<nodes,boxes,primitives,rays> (traversal cost heatmaps, built with TRAVERSAL_STATS)");
+		dbLog(dbg::LOG_ERROR, "         --format=<png|pfm|exr> --aov-format=<png|pfm|exr> --png-level=<0-9> --png-threads=<n>");
+		dbLog(dbg::LOG_ERROR, "         --stream=<file|pipe|-> --stream-format=<y4m|rgb> --fps=<n> --stream-queue=<frames>");
+		dbLog(dbg::LOG_ERROR, "         --progress=<bar|json|off> --progress-interval=<seconds> --progress-file=<file>");
+		dbLog(dbg::LOG_ERROR, "         --lazy-textures --texture-threads=<n>");
+		dbLog(dbg::LOG_ERROR, "         --texture-cache=<MB> --texture-cache-dir=<dir>");
+		dbLog(dbg::LOG_ERROR, "         --trace=<file> (Chrome trace JSON for Perfetto)");
+		return 1;
+	}
+
+	// zones are recorded from here on, the timeline starts with the scene load
+	if (options.contains("trace")) {
+		trace::start();
+		trace::setThreadName("Main");
+	}
+
+	TextureManager::Settings textureSettings;
+	textureSettings.lazy = options.contains("lazy-textures");
+	if (!parseOption(options, "texture-threads", textureSettings.threads)) return 1;
+	std::size_t textureCacheMB = 0;
+	if (!parseOption(options, "texture-cache", textureCacheMB)) return 1;
+	if (textureCacheMB > std::numeric_limits<std::size_t>::max() >> 20) {
+		dbLog(dbg::LOG_ERROR, "Invalid value for --texture-cache: ", textureCacheMB, " MB is too large");
 		return 1;
 	}
+	textureSettings.cacheBytes = textureCacheMB << 20;
+	if (options.contains("texture-cache-dir")) textureSettings.cacheFolder = options.at("texture-cache-dir");
 
 	std::unique_ptr<Scene> sc;
 	try {
-		sc = std::make_unique<Scene>(argv[1]);
+		sc = std::make_unique<Scene>(argv[1], textureSettings);
 	} catch (const std::exception& e) {
 		dbLog(dbg::LOG_ERROR, "Failed to load scene: ", e.what());
 		return 1;
@@ -73,16 +158,226 @@ int main(int argc, char** argv) {
 		}
 	}
 
+	bool checkpointing = options.contains("checkpoint");
+	bool progressive   = options.contains("progressive") || options.contains("time-limit") || checkpointing;
+	Renderer::ProgressiveSettings progressiveSettings;
+	progressiveSettings.maxSamples = argc > 3 ? spp : 0;
+	if (!parseOption(options, "time-limit", progressiveSettings.timeLimit) ||
+		!parseOption(options, "preview", progressiveSettings.previewInterval) ||
+		!parseOption(options, "checkpoint", progressiveSettings.checkpointInterval)) {
+		return 1;
+	}
+	if (options.contains("preview-file")) progressiveSettings.previewFile = options["preview-file"];
+
+	float timeBudget = 0.f;
+	if (!parseOption(options, "time-budget", timeBudget)) return 1;
+
+	int tileSize = 0;
+	if (!parseOption(options, "tile-size", tileSize)) return 1;
+	TileOrder tileOrder = TileOrder::Hilbert;
+	if (options.contains("tile-order")) {
+		try {
+			tileOrder = tileOrderFromString(options["tile-order"]);
+		} catch (const std::exception &e) {
+			dbLog(dbg::LOG_ERROR, e.what());
+			return 1;
+		}
+	}
+	SamplerType samplerType = SamplerType::Sobol;
+	if (options.contains("sampler")) {
+		try {
+			samplerType = samplerTypeFromString(options["sampler"]);
+		} catch (const std::exception &e) {
+			dbLog(dbg::LOG_ERROR, e.what());
+			return 1;
+		}
+	}
+
+	DenoiseSettings denoiseSettings;
+	if (!parseOption(options, "denoise-iterations", denoiseSettings.iterations)) return 1;
+	const bool denoise = options.contains("denoise") || options.contains("denoise-iterations");
+
+	std::vector<AOV> aovs;
+	if (options.contains("aov")) {
+		try {
+			for (auto name : std::views::split(std::string_view(options["aov"]), ',')) {
+				aovs.push_back(aovFromString(std::string_view(name.begin(), name.end())));
+			}
+		} catch (const std::exception &e) {
+			dbLog(dbg::LOG_ERROR, e.what());
+			return 1;
+		}
+	}
+
+	ImageFormat format = ImageFormat::PNG, aovFormat = ImageFormat::PNG;
+	try {
+		if (options.contains("format")) format = imageFormatFromString(options["format"]);
+		if (options.contains("aov-format")) aovFormat = imageFormatFromString(options["aov-format"]);
+	} catch (const std::exception &e) {
+		dbLog(dbg::LOG_ERROR, e.what());
+		return 1;
+	}
+	if (!parseOption(options, "png-level", pngSettings.level) || !parseOption(options, "png-threads", pngSettings.threads)) {
+		return 1;
+	}
+	const auto extension = imageFormatExtension(format);
+	// EXR images carry the AOVs as layers, separate AOV files are only written for other formats or when asked for
+	const bool aovLayers = format == ImageFormat::EXR;
+	const bool aovFiles	 = !aovLayers || options.contains("aov-format");
+
+	// frames go to a video stream instead of image files
+	std::unique_ptr<VideoWriter> video;
+	int							 streamQueue = 4;
+	if (options.contains("stream")) {
+		int fps = 24;
+		if (!parseOption(options, "fps", fps) || !parseOption(options, "stream-queue", streamQueue)) return 1;
+		if (checkpointing) {
+			dbLog(dbg::LOG_ERROR, "--checkpoint can not be combined with --stream");
+			return 1;
+		}
+		try {
+			VideoFormat videoFormat = VideoFormat::Y4M;
+			if (options.contains("stream-format")) videoFormat = videoFormatFromString(options["stream-format"]);
+			// a reader that goes away makes the writes fail instead of killing the process
+			std::signal(SIGPIPE, SIG_IGN);
+			video = std::make_unique<VideoWriter>(options["stream"], videoFormat, fps);
+		} catch (const std::exception &e) {
+			dbLog(dbg::LOG_ERROR, e.what());
+			return 1;
+		}
+	}
+
+	ProgressReporter::Settings progressSettings;
+	std::ofstream			   progressFile;
+	if (!parseOption(options, "progress-interval", progressSettings.interval)) return 1;
+	try {
+		if (options.contains("progress")) progressSettings.format = progressFormatFromString(options["progress"]);
+	} catch (const std::exception &e) {
+		dbLog(dbg::LOG_ERROR, e.what());
+		return 1;
+	}
+	if (options.contains("progress-file")) {
+		progressFile.open(options["progress-file"]);
+		if (!progressFile) {
+			dbLog(dbg::LOG_ERROR, "Failed to open progress file: ", options["progress-file"]);
+			return 1;
+		}
+		progressSettings.json = &progressFile;
+	} else if (progressSettings.format == ProgressFormat::JSON && video && options["stream"] == "-") {
+		// stdout carries the video
+		progressSettings.json = &std::cerr;
+	}
+
 	Renderer rend(*sc, resolution_scale, threadCount, spp);
-	dbLog(dbg::LOG_INFO, "Starting animation render with ", sc->frameCount, "frames");
-	for (int i = 0; i < (entire_animation ? sc->frameCount : 1); ++i) {
-		if(entire_animation) sc->setFrame(i);
-		auto start = std::chrono::high_resolution_clock::now();
-		rend.render();
-		auto end	  = std::chrono::high_resolution_clock::now();
-		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-		dbLog(dbg::LOG_INFO, "Rendering completed in ", duration.count(), " ms");
-		rend.saveImage(std::format("output_{:0>3}.png", i));
+	rend.setProgress(progressSettings);
+	rend.setTiling(tileSize, tileOrder);
+	rend.setSampler(samplerType);
+	rend.setDenoise(denoise, denoiseSettings);
+	rend.setAOVs(!aovs.empty());
+	if (progressive || timeBudget > 0.f) {
+		activeRenderer = &rend;
+		std::signal(SIGINT, onInterrupt);
+		std::signal(SIGTERM, onInterrupt);
+	}
+
+	// frames are encoded and written on this thread while the next one renders
+	SerialWorker writer(2, "Writer");
+	// queued frames keep the renderer going while the stream reader is busy, it only waits once the queue is full
+	SerialWorker streamer(streamQueue, "Streamer");
+	using Layers = std::vector<std::pair<AOV, Image<RGBA32F>>>;
+	auto writeFrame = [&](const Image<RGBA32F> &img, const std::string &output, const std::string &checkpoint,
+						  Layers &&layers) {
+		if (video) {
+			streamer.push([img, &video = *video]() {
+				trace::Zone zone("Stream frame");
+				perf::Scope scope(perf::Phase::Export);
+				video.write(img);
+			});
+			return;
+		}
+		writer.push([img, output, checkpoint, layers = std::move(layers)]() {
+			if (checkpoint.empty()) {
+				Renderer::saveImage(img, output, layers);
+				return;
+			}
+			// write under a temporary name so a killed process never leaves a partial image behind, the name keeps
+			// the extension that picks the format
+			auto temporary = std::filesystem::path(output);
+			temporary.replace_filename("tmp_" + temporary.filename().string());
+			Renderer::saveImage(img, temporary.string(), layers);
+			std::filesystem::rename(temporary, output);
+			std::filesystem::remove(checkpoint);
+		});
+	};
+	// AOV files are written before the image, which marks the frame as done, returns the layers of the image
+	auto writeAOVs = [&](int frame) {
+		Layers layers;
+		for (AOV aov : aovs) {
+			if (aovLayers) layers.emplace_back(aov, rend.getAOV(aov));
+			if (!aovFiles) continue;
+			auto output = std::format("output_{:0>3}_{}.{}", frame, aovName(aov), imageFormatExtension(aovFormat));
+			writer.push([aov, output, aovFormat, img = rend.getAOV(aov)]() mutable {
+				// float formats keep the raw values
+				if (aovFormat == ImageFormat::PNG) visualizeAOV(aov, img);
+				Renderer::saveImage(img, output);
+			});
+		}
+		return layers;
+	};
+
+	const int frameCount = entire_animation ? sc->frameCount : 1;
+	dbLog(dbg::LOG_INFO, "Starting animation render with ", frameCount, " frames");
+
+	if (entire_animation && !progressive && timeBudget <= 0.f && rend.framesPerBatch() > 1) {
+		// frames are too small to keep every thread busy, render several at once
+		std::vector<int> batch;
+		for (int i = 0; i < frameCount; i += batch.size()) {
+			batch.resize(std::min<std::size_t>(rend.framesPerBatch(), frameCount - i));
+			std::iota(batch.begin(), batch.end(), i);
+			Timer timer;
+			rend.renderFrames(batch, [&](int frame, const Image<RGBA32F> &img) {
+				writeFrame(img, std::format("output_{:0>3}.{}", frame, extension), "", writeAOVs(frame));
+			});
+			dbLog(dbg::LOG_INFO, "Rendered frames ", batch.front(), "-", batch.back(), " in ",
+				  timer.elapsed<std::chrono::milliseconds>(), " ms");
+		}
+	} else {
+		for (int i = 0; i < frameCount; ++i) {
+			auto output = std::format("output_{:0>3}.{}", i, extension);
+			if (checkpointing) {
+				// a frame is complete when its image exists and no checkpoint is left behind
+				progressiveSettings.checkpointFile = std::format("output_{:0>3}.ckpt", i);
+				if (std::filesystem::exists(output) && !std::filesystem::exists(progressiveSettings.checkpointFile)) {
+					dbLog(dbg::LOG_INFO, "Skipping frame ", i, ", ", output, " already exists");
+					continue;
+				}
+			}
+
+			if(entire_animation) sc->setFrame(i);
+			rend.setSeed(i);
+			auto start = std::chrono::high_resolution_clock::now();
+			if (timeBudget > 0.f) rend.renderTimeBudget(timeBudget);
+			else if (progressive) rend.renderProgressive(progressiveSettings);
+			else rend.render();
+			auto end	  = std::chrono::high_resolution_clock::now();
+			auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+			dbLog(dbg::LOG_INFO, "Rendering completed in ", duration.count(), " ms");
+			if (checkpointing && rend.wasStopped()) {
+				dbLog(dbg::LOG_INFO, "Render interrupted, progress saved to ", progressiveSettings.checkpointFile);
+				break;
+			}
+			writeFrame(rend.getImage(), output, checkpointing ? progressiveSettings.checkpointFile : "", writeAOVs(i));
+			if (rend.wasStopped()) break;
+		}
+	}
+	writer.wait();
+	streamer.wait();
+	// again with the export of the last frame
+	perf::logSummary();
+	if (trace::isEnabled()) {
+		try {
+			trace::write(options["trace"]);
+		} catch (const std::exception &e) { dbLog(dbg::LOG_ERROR, e.what()); }
 	}
 
 	system("fish -c 'feh output_000.png'");
@@ -19,27 +19,30 @@ DiffuseMaterial::DiffuseMaterial(const JSONObject &obj, const Scene &scene) : Ma
 		this->albedoColor			 = vec3(0, 0, 0);
 		std::string_view textureName = obj["albedo"].as<JSONString>();
 		albedo						 = scene.getTexture(textureName);
+		// only the textures materials use are loaded, see TextureManager::loadRequired()
+		albedo->require();
 	} else {
 		throw std::runtime_error("Invalid albedo type for DiffuseMaterial");
 	}
 	doubleSided = false;
 }
 
-vec3 cosWeightedHemissphereDir(vec3 normal, uint32_t &seed) {
-	float z = randomFloat(seed) * 2.0 - 1.0;
-	float a = randomFloat(seed) * 2.0 * M_PI;
-	float r = sqrt(1.0 - z * z);
-	float x = r * cos(a);
-	float y = r * sin(a);
+vec3 cosWeightedHemissphereDir(vec3 normal, Sampler &sampler) {
+	vec2  u = sampler.get2D();
+	float z = u.x * 2.f - 1.f;
+	float a = u.y * 2.f * M_PIf;
+	float r = std::sqrt(1.f - z * z);
+	float s, c;
+	fast::sincos(a, s, c);
 
 	// Convert unit vector in sphere to a cosine weighted vector in hemissphere
-	auto res = normal + vec3(x, y, z);
-	if (res.x > 0.001f || res.y > 0.001f || res.z > 0.001f) res = normalize(res);
+	auto res = normal + vec3(r * c, r * s, z);
+	if (res.x > 0.001f || res.y > 0.001f || res.z > 0.001f) res = fast::normalize(res);
 	else res = normal;
 	return res;
 }
 
-vec4 DiffuseMaterial::shade(const RayHit &hit, const Ray &, const Scene &scene, uint32_t &seed) const {
+vec4 DiffuseMaterial::shade(const RayHit &hit, const Ray &ray, const Scene &scene, Sampler &sampler) const {
 	if (hit.depth >= MAX_DEPTH) { return scene.backgroundColor; }
 	vec3 color = 0;
 	//return vec4(hit.pos, 1.f);
@@ -50,7 +53,7 @@ vec4 DiffuseMaterial::shade(const RayHit &hit, const Ray &, const Scene &scene,
 		lightDir /= distance;
 
 		if (this->receivesShadows) {
-			auto shadowHit = scene.intersect(Ray(hit.pos + hit.normal * EPS, lightDir, Ray::Type::Shadow));
+			auto shadowHit = scene.intersect(Ray(hit.pos + hit.normal * EPS, lightDir, Ray::Type::Shadow), hit.depth);
 			if (shadowHit.t > EPS && shadowHit.t * shadowHit.t < distanceSq - EPS) {
 				continue;	  // shadow
 			}
@@ -59,16 +62,17 @@ vec4 DiffuseMaterial::shade(const RayHit &hit, const Ray &, const Scene &scene,
 		color += light.color * light.intensity * std::max(0.f, dot(hit.normal, lightDir)) / (4.f * M_PIf * distanceSq);
 	}
 
-	vec3   randomDir = cosWeightedHemissphereDir(hit.normal, seed);
+	vec3   randomDir = cosWeightedHemissphereDir(hit.normal, sampler);
 	Ray	   reflectedRay(hit.pos + randomDir * EPS, randomDir);
-	RayHit reflectedHit = scene.intersect(reflectedRay);
+	reflectedRay.continueCone(ray, hit.coneWidth);
+	RayHit reflectedHit = scene.intersect(reflectedRay, hit.depth + 1);
 	if (reflectedHit.objectIndex != -1u) {
 		reflectedHit.depth	 = hit.depth + 1;
 		const auto	mat_id	 = scene.getObjects()[reflectedHit.objectIndex]->getMaterialIndex();
 		const auto &material = scene.materials[mat_id];
 		scene.fillHitInfo(reflectedHit, reflectedRay, material->smooth);
 		color +=
-			material->shade(reflectedHit, reflectedRay, scene, seed)._xyz() * std::max(0.f, dot(hit.normal, randomDir));
+			material->shade(reflectedHit, reflectedRay, scene, sampler)._xyz() * std::max(0.f, dot(hit.normal, randomDir));
 	} else {
 		color += scene.backgroundColor.xyz();
 	}
@@ -82,18 +86,19 @@ vec4 DiffuseMaterial::shade(const RayHit &hit, const Ray &, const Scene &scene,
 	return vec4(color, 1.0f);
 }
 
-vec4 ReflectiveMaterial::shade(const RayHit &hit, const Ray &ray, const Scene &scene, uint32_t &seed) const {
+vec4 ReflectiveMaterial::shade(const RayHit &hit, const Ray &ray, const Scene &scene, Sampler &sampler) const {
 	if (hit.depth >= MAX_DEPTH) { return scene.backgroundColor; }
 	vec3   color		= 0;
-	vec3   reflectedDir = normalize(reflect(ray.direction, hit.normal));
+	vec3   reflectedDir = fast::normalize(reflect(ray.direction, hit.normal));
 	Ray	   reflectedRay(hit.pos + hit.normal * EPS, reflectedDir);
-	RayHit reflectedHit = scene.intersect(reflectedRay);
+	reflectedRay.continueCone(ray, hit.coneWidth);
+	RayHit reflectedHit = scene.intersect(reflectedRay, hit.depth + 1);
 	if (reflectedHit.objectIndex != -1u) {
 		reflectedHit.depth	 = hit.depth + 1;
 		const auto	mat_id	 = scene.getObjects()[reflectedHit.objectIndex]->getMaterialIndex();
 		const auto &material = scene.materials[mat_id];
 		scene.fillHitInfo(reflectedHit, reflectedRay, material->smooth);
-		color = material->shade(reflectedHit, reflectedRay, scene, seed).xyz();
+		color = material->shade(reflectedHit, reflectedRay, scene, sampler).xyz();
 	} else {
 		color = scene.backgroundColor.xyz();
 	}
@@ -107,7 +112,7 @@ static inline float F0(float ior1, float ior2) {
 
 static inline float FresnelSchlick(const vec3 &I, const vec3 &N, float f0) {
 	float cosTheta = dot(I, N);
-	return f0 + (1.0f - f0) * std::pow(std::clamp(1.0f - cosTheta, 0.0f, 1.0f), 5.0f);
+	return f0 + (1.0f - f0) * fast::pown<5>(std::clamp(1.0f - cosTheta, 0.0f, 1.0f));
 }
 
 static inline float fresnelReflectAmount(float n1, float n2, vec3 normal, vec3 incident, float f0, float f90) {
@@ -129,7 +134,7 @@ static inline float fresnelReflectAmount(float n1, float n2, vec3 normal, vec3 i
 	return f0 * (1.f - ret) + f90 * ret;
 }
 
-vec4 RefractiveMaterial::shade(const RayHit &hit, const Ray &ray, const Scene &scene, uint32_t &seed) const {
+vec4 RefractiveMaterial::shade(const RayHit &hit, const Ray &ray, const Scene &scene, Sampler &sampler) const {
 	if (hit.depth >= MAX_DEPTH) { return scene.backgroundColor; }
 	vec3  color		 = 0;
 	float dotNormal	 = dot(hit.normal, ray.direction);
@@ -148,9 +153,11 @@ vec4 RefractiveMaterial::shade(const RayHit &hit, const Ray &ray, const Scene &s
 	float eta		= ior1 / ior2;	   // Snell's law
 	vec3  normalEPS = normal * EPS;
 
-	Ray reflectedRay(hit.pos + normalEPS, normalize(reflect(ray.direction, normal)));
+	Ray reflectedRay(hit.pos + normalEPS, fast::normalize(reflect(ray.direction, normal)));
 	Ray refractedRay(hit.pos - normalEPS, refract(ray.direction, normal, eta));
-	if (refractedRay.direction != vec3(0.f)) refractedRay.direction = normalize(refractedRay.direction);
+	reflectedRay.continueCone(ray, hit.coneWidth);
+	refractedRay.continueCone(ray, hit.coneWidth);
+	if (refractedRay.direction != vec3(0.f)) refractedRay.direction = fast::normalize(refractedRay.direction);
 	if (isnan(refractedRay.direction)) {
 		dbLog(dbg::LOG_ERROR, ray.direction, normal, eta, refract(ray.direction, normal, eta));
 		// assert(false);
@@ -159,37 +166,49 @@ vec4 RefractiveMaterial::shade(const RayHit &hit, const Ray &ray, const Scene &s
 	float f0	  = F0(ior1, ior2);
 	float fresnel = fresnelReflectAmount(ior1, ior2, normal, ray.direction, f0, 1.0f);
 
-	float randomSelect = randomFloat(seed);
+	float randomSelect = sampler.get1D();
 	
 	// importance sampling the fresnel term
 	if (randomSelect < fresnel) {
-		RayHit reflectedHit = scene.intersect(reflectedRay);
+		RayHit reflectedHit = scene.intersect(reflectedRay, hit.depth + 1);
 		if (reflectedHit.objectIndex != -1u) {
 			reflectedHit.depth = hit.depth + 1;
 			const auto mat_id  = scene.getObjects()[reflectedHit.objectIndex]->getMaterialIndex();
 			assert(mat_id < scene.materials.size());
 			const auto &material = scene.materials[mat_id];
 			scene.fillHitInfo(reflectedHit, reflectedRay, material->smooth);
-			color = material->shade(reflectedHit, reflectedRay, scene, seed)._xyz();
+			color = material->shade(reflectedHit, reflectedRay, scene, sampler)._xyz();
 		} else {
 			color = scene.backgroundColor.xyz();
 		}
 	} else {
-		RayHit refractedHit = scene.intersect(refractedRay);
+		RayHit refractedHit = scene.intersect(refractedRay, hit.depth + 1);
 		if (refractedHit.objectIndex != -1u) {
 			refractedHit.depth = hit.depth + 1;
 			const auto mat_id  = scene.getObjects()[refractedHit.objectIndex]->getMaterialIndex();
 			assert(mat_id < scene.materials.size());
 			const auto &material = scene.materials[mat_id];
 			scene.fillHitInfo(refractedHit, refractedRay, material->smooth);
-			color = material->shade(refractedHit, refractedRay, scene, seed)._xyz();
+			color = material->shade(refractedHit, refractedRay, scene, sampler)._xyz();
 		} else {
 			color = scene.backgroundColor.xyz();
 		}
 	}
 	if(!isEntering) {
-		color *= exp(this->absorbtion * -hit.t);	 // Attenuate color for exiting the object
+		color *= fast::exp(this->absorbtion * -hit.t);	 // Attenuate color for exiting the object
 	}
 
 	return vec4(color, 1.0f);
 }
+
+bool RefractiveMaterial::getSpecularDirection(const RayHit &hit, const Ray &ray, vec3 &direction) const {
+	const bool isEntering = dot(hit.normal, ray.direction) < 0.0f;
+	const vec3 normal	  = isEntering ? hit.normal : -hit.normal;
+	const float eta		  = isEntering ? 1.0f / ior : ior;
+
+	// the refracted direction, unless there is total internal reflection
+	direction = refract(ray.direction, normal, eta);
+	if (direction == vec3(0.f)) direction = reflect(ray.direction, normal);
+	direction = normalize(direction);
+	return true;
+}
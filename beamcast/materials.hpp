@@ -2,6 +2,7 @@
 
 #include <data.hpp>
 #include <textures.hpp>
+#include <sample.hpp>
 
 class Scene;
 
@@ -21,7 +22,15 @@ class Material {
 		}
 	}
 
-	virtual vec4 shade(const RayHit &hit, const Ray &ray, const Scene &scene, uint32_t &seed) const = 0;
+	virtual vec4 shade(const RayHit &hit, const Ray &ray, const Scene &scene, Sampler &sampler) const = 0;
+
+	/// @brief reflectance at \a hit, without lighting. Guides the denoiser.
+	virtual vec3 getAlbedo(const RayHit &) const { return vec3(1.f); }
+
+	/// @brief For perfectly specular materials, writes the direction most of the light at \a hit comes from.
+	/// The denoiser takes its features from what is seen in that direction.
+	/// @return false if the material is not specular
+	virtual bool getSpecularDirection(const RayHit &, const Ray &, vec3 &) const { return false; }
 
 	virtual ~Material() = default;
 };
@@ -34,7 +43,8 @@ class DiffuseMaterial : public Material {
 	DiffuseMaterial(const vec3 &albedo) : albedo(nullptr), albedoColor(albedo) {}
 
 	DiffuseMaterial(const JSONObject &obj, const Scene &scene);
-	vec4 shade(const RayHit &hit, const Ray &, const Scene &scene, uint32_t &seed) const override;
+	vec4 shade(const RayHit &hit, const Ray &, const Scene &scene, Sampler &sampler) const override;
+	vec3 getAlbedo(const RayHit &hit) const override { return albedo ? albedo->sample(hit) : albedoColor; }
 };
 
 class ReflectiveMaterial : public Material {
@@ -48,7 +58,12 @@ class ReflectiveMaterial : public Material {
 		albedo = vec3{colorJSON[0].as<JSONNumber>(), colorJSON[1].as<JSONNumber>(), colorJSON[2].as<JSONNumber>()};
 	}
 
-	vec4 shade(const RayHit &hit, const Ray &, const Scene &scene, uint32_t &seed) const override;
+	vec4 shade(const RayHit &hit, const Ray &, const Scene &scene, Sampler &sampler) const override;
+	vec3 getAlbedo(const RayHit &) const override { return albedo; }
+	bool getSpecularDirection(const RayHit &hit, const Ray &ray, vec3 &direction) const override {
+		direction = normalize(reflect(ray.direction, hit.normal));
+		return true;
+	}
 };
 
 class RefractiveMaterial : public Material {
@@ -73,7 +88,8 @@ class RefractiveMaterial : public Material {
 		doubleSided = true;
 	}
 
-	vec4 shade(const RayHit &hit, const Ray &, const Scene &scene, uint32_t &seed) const override;
+	vec4 shade(const RayHit &hit, const Ray &, const Scene &scene, Sampler &sampler) const override;
+	bool getSpecularDirection(const RayHit &hit, const Ray &ray, vec3 &direction) const override;
 };
 
 class ConstantMaterial : public Material {
@@ -87,5 +103,6 @@ class ConstantMaterial : public Material {
 		albedo = vec3{albedoJSON[0].as<JSONNumber>(), albedoJSON[1].as<JSONNumber>(), albedoJSON[2].as<JSONNumber>()};
 	}
 
-	vec4 shade(const RayHit &, const Ray &, const Scene &, uint32_t &) const override { return vec4(albedo, 1.0f); }
+	vec4 shade(const RayHit &, const Ray &, const Scene &, Sampler &) const override { return vec4(albedo, 1.0f); }
+	vec3 getAlbedo(const RayHit &) const override { return albedo; }
 };
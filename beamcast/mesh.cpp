@@ -31,8 +31,6 @@ bool Mesh::intersect(const Ray& ray, float tMin, float tMax, RayHit& hit, const
 
 MeshObject::MeshObject(const Scene& scene, std::size_t meshIndex, const JSONObject& obj)
 	: meshIndex(meshIndex), scene(&scene) {
-	transform = identity<float, 4>();
-	inverseTransform = identity<float, 4>();
 	this->scene = &scene;
 
 	if (obj.find("material_index") != obj.end()) {
@@ -44,23 +42,27 @@ MeshObject::MeshObject(const Scene& scene, std::size_t meshIndex, const JSONObje
 	if(obj.find("transform") != obj.end()) {
 		const auto &t = obj["transform"].as<JSONArray>();
 		if(t.size() != 16) throw std::runtime_error("wrong number of values in matrix");
-		transform = mat4(
+		const mat4 matrix = mat4(
 			vec4(t[0].as<JSONNumber>(), t[1].as<JSONNumber>(), t[2].as<JSONNumber>(),t[3].as<JSONNumber>()),
 			vec4(t[4].as<JSONNumber>(), t[5].as<JSONNumber>(), t[6].as<JSONNumber>(),t[7].as<JSONNumber>()),
 			vec4(t[8].as<JSONNumber>(), t[9].as<JSONNumber>(), t[10].as<JSONNumber>(),t[11].as<JSONNumber>()),
 			vec4(t[12].as<JSONNumber>(), t[13].as<JSONNumber>(), t[14].as<JSONNumber>(),t[15].as<JSONNumber>()));
+		if (matrix[3] != vec4(0.f, 0.f, 0.f, 1.f)) {
+			dbLog(dbg::LOG_WARNING, "Object transform has a projective row, it is ignored: ", matrix[3]);
+		}
 
-		inverseTransform = invert(transform);
+		// instance transforms are affine, so the projective row is dropped
+		transform		 = affine3(matrix);
+		inverseTransform = transform.inverse();
 
-		isIdentity = transform == identity<float, 4>();
+		isIdentity = matrix == identity<float, 4>();
 	}
 
 	const auto& mesh		  = this->scene->meshes[meshIndex];
 	vec3		boundsBase[2] = {mesh.box.min, mesh.box.max};
 	for (int i = 0; i < 8; ++i) {
-		auto boundPoint	 = vec3(boundsBase[(i & 1)].x, boundsBase[(i & 2)].y, boundsBase[(i & 4)].z);
-		auto transformed = transform * vec4(boundPoint, 1.0f);
-		box.add(transformed.xyz());
+		auto boundPoint	 = vec3(boundsBase[i & 1].x, boundsBase[(i >> 1) & 1].y, boundsBase[(i >> 2) & 1].z);
+		box.add(transform.transformPoint(boundPoint));
 	}
 	//mesh.expandBox(box);
 }
@@ -69,8 +71,8 @@ bool MeshObject::intersect(const Ray& ray, float tMin, float tMax, RayHit& inter
 	Ray r(ray);
 
 	if(!isIdentity) {
-		r.origin = (inverseTransform * vec4(r.origin, 1.0f)).xyz();
-		r.direction = (inverseTransform * vec4(r.direction, 0.0f)).xyz();
+		r.origin = inverseTransform.transformPoint(r.origin);
+		r.direction = inverseTransform.transformVector(r.direction);
 	}
 
 	if (materialIndex >= scene->materials.size()) {
@@ -94,9 +96,33 @@ bool MeshObject::intersect(const Ray& ray, float tMin, float tMax, RayHit& inter
 }
 
 void MeshObject::fillHitInfo(RayHit& hit, const Ray& ray, bool smooth) const {
-	scene->meshes[meshIndex].fillHitInfo(hit, ray, smooth);
+	const auto& mesh = scene->meshes[meshIndex];
+	mesh.fillHitInfo(hit, ray, smooth);
 	if(!isIdentity)
-		hit.normal = (transform * vec4(hit.normal, 0.0f)).xyz();
+		hit.normal = transform.transformVector(hit.normal);
+	if (hit.triangleIndex == -1u || (ray.coneSpread == 0.f && ray.coneWidth == 0.f)) return;
+
+	// the cone width is scaled by the texture coordinates per world unit of the triangle and stretched by the angle
+	// it hits it at
+	hit.coneWidth		  = ray.coneWidth + ray.coneSpread * hit.t;
+	const ivec3&	  tri = mesh.getIndices()[hit.triangleIndex];
+	const auto&		  v	  = mesh.getVertices();
+	const auto&		  uv  = mesh.getTexCoords();
+	vec3			  e1  = v[tri.y] - v[tri.x], e2 = v[tri.z] - v[tri.x];
+	if (!isIdentity) {
+		e1 = transform.transformVector(e1);
+		e2 = transform.transformVector(e2);
+	}
+	const vec3	n		  = cross(e1, e2);
+	const float worldArea = length(n);
+	const vec2	t1 = (uv[tri.y] - uv[tri.x]).xy(), t2 = (uv[tri.z] - uv[tri.x]).xy();
+	const float uvArea = std::abs(t1.x * t2.y - t1.y * t2.x);
+	if (worldArea <= 0.f || uvArea <= 0.f) {
+		hit.uvFootprint = 0.f;
+		return;
+	}
+	const float cosine = std::abs(dot(n, ray.direction)) / (worldArea * length(ray.direction));
+	hit.uvFootprint	   = hit.coneWidth * std::sqrt(uvArea / worldArea) / std::max(cosine, 1e-3f);
 }
 const std::vector<vec3>&  MeshObject::getVertices() const { return scene->meshes[meshIndex].getVertices(); }
 const std::vector<vec3>&  MeshObject::getNormals() const { return scene->meshes[meshIndex].getNormals(); }
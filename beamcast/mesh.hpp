@@ -23,7 +23,8 @@ class Mesh : public Primitive {
 	Mesh& operator=(Mesh&&)		 = default;
 
 	Mesh(const JSONObject& obj) {
-		auto& verticesJSON = obj["vertices"].as<JSONArray>();
+		auto&		verticesJSON = obj["vertices"].as<JSONArray>();
+		trace::Zone zone("Load mesh", "vertices", verticesJSON.size() / 3);
 		this->vertices.reserve(verticesJSON.size() / 3);
 		for (unsigned int i = 0; i < verticesJSON.size(); i += 3) {
 			if (i + 2 >= verticesJSON.size()) {
@@ -133,6 +134,7 @@ class Mesh : public Primitive {
 
 	inline constexpr auto& getVertices() const { return vertices; }
 	inline constexpr auto& getNormals() const { return normals; }
+	inline constexpr auto& getTexCoords() const { return texCoords; }
 	inline constexpr auto& getIndices() const { return indices; }
 	inline constexpr auto& getTriangleNormals() const { return triangleNormals; }
 
@@ -148,8 +150,8 @@ class Mesh : public Primitive {
 class MeshObject : public Primitive {
    public:
 	std::size_t	 meshIndex = 0;
-	mat4		 transform;
-	mat4		inverseTransform;
+	affine3		 transform;
+	affine3		 inverseTransform;
 	const Scene* scene;
 	std::size_t materialIndex = 0;
 	bool isIdentity = true;
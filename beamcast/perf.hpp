@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef BEAMCAST_PERF
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <x86intrin.h>
+#endif
+
+#include <log.hpp>
+
+/*
+ * Hardware performance counters per thread, compiled in with BEAMCAST_PERF (the PERF_COUNTERS CMake option).
+ * Every thread that enters a Scope opens its own perf_event_open group for user space cycles, instructions, cache
+ * misses and branch misses. The counts between two scope changes go to the phase that was active, nested scopes
+ * pause the outer one. Counters are read with rdpmc when the kernel allows it and with read() otherwise. Scopes on
+ * hot paths, like the one around every ray, only count when rdpmc can read the counters, so a read() syscall never
+ * costs more than the code it measures; otherwise their time goes to the enclosing phase.
+ * The counts are not scaled when the kernel multiplexes the group with other perf events, rdpmc and read() have to
+ * agree for the differences between them. logSummary() logs how much of the time the counters ran instead.
+ * When perf_event_open is not permitted or the CPU has no PMU (containers, most VMs) a warning is logged once and
+ * scopes do nothing. Without BEAMCAST_PERF all of it compiles to nothing.
+ */
+namespace perf {
+#ifdef BEAMCAST_PERF
+inline constexpr bool ENABLED = true;
+#else
+inline constexpr bool ENABLED = false;
+#endif
+
+/// Export also covers resolving and denoising the final image
+enum class Phase { None, Build, Trace, Shade, Export, Count };
+
+inline constexpr std::array<const char *, std::size_t(Phase::Count)> PHASE_NAMES = {"none", "build", "trace", "shade",
+																				   "export"};
+
+enum Event { Cycles, Instructions, CacheMisses, BranchMisses, EventCount };
+
+using Counts = std::array<uint64_t, EventCount>;
+
+/// The counters of one thread and what they counted in every phase
+class ThreadCounters {
+	/// written by the owning thread only, read by summary()
+	std::array<std::array<std::atomic_uint64_t, EventCount>, std::size_t(Phase::Count)> totals{};
+	Phase current = Phase::None;
+	Counts last{};
+	/// nanoseconds the group was enabled and counting, they differ while it is multiplexed, read by summary()
+	std::atomic_uint64_t timeEnabled = 0, timeRunning = 0;
+
+#ifdef BEAMCAST_PERF
+	std::array<int, EventCount>								 fds;
+	std::array<const perf_event_mmap_page *, EventCount> pages{};
+	bool													 rdpmc = true;
+
+	static constexpr std::array<uint64_t, EventCount> CONFIGS = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+																 PERF_COUNT_HW_CACHE_MISSES,
+																 PERF_COUNT_HW_BRANCH_MISSES};
+
+	enum class Mapped { Read, NotScheduled, Unsupported };
+
+	/// @brief Reads a counter from user space, see the perf_event_mmap_page documentation
+	static Mapped readMapped(const perf_event_mmap_page *page, uint64_t &value) {
+		uint32_t seq;
+		do {
+			seq = page->lock;
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+			const uint32_t index = page->index;
+			if (!page->cap_user_rdpmc) return Mapped::Unsupported;
+			// 0 while the group is not scheduled on a PMU
+			if (index == 0) return Mapped::NotScheduled;
+			int64_t count = __rdpmc(index - 1);
+			count <<= 64 - page->pmc_width;
+			count >>= 64 - page->pmc_width;
+			value = page->offset + count;
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		} while (page->lock != seq);
+		return Mapped::Read;
+	}
+#endif
+
+	/// @param hot - fail instead of making a read() syscall if rdpmc cannot read the counters
+	/// @return false if \a values were not read
+	bool read(Counts &values, bool hot) {
+#ifdef BEAMCAST_PERF
+		Mapped mapped = rdpmc ? Mapped::Read : Mapped::Unsupported;
+		for (std::size_t i = 0; mapped == Mapped::Read && i < EventCount; ++i) mapped = readMapped(pages[i], values[i]);
+		if (mapped == Mapped::Read) {
+			// updated by the kernel when the group is scheduled, close enough for the share of time it ran
+			timeEnabled.store(pages[0]->time_enabled, std::memory_order_relaxed);
+			timeRunning.store(pages[0]->time_running, std::memory_order_relaxed);
+			return true;
+		}
+		// the kernel does not allow rdpmc (perf_event_paranoid, rdpmc sysfs setting), it will not change later
+		if (mapped == Mapped::Unsupported) rdpmc = false;
+		if (hot) return false;
+
+		// { nr, time_enabled, time_running, values[nr] } of the whole group
+		std::array<uint64_t, EventCount + 3> group{};
+		if (::read(fds[0], group.data(), sizeof(group)) != ssize_t(sizeof(group))) return false;
+		timeEnabled.store(group[1], std::memory_order_relaxed);
+		timeRunning.store(group[2], std::memory_order_relaxed);
+		std::copy(group.begin() + 3, group.end(), values.begin());
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/// @brief Adds the counts since the last change to the current phase and makes \a phase current
+	/// @param hot - see read(), if the counters cannot be read cheaply nothing is counted and false is returned
+	bool enter(Phase phase, bool hot = false) {
+		Counts now{};
+		if (!read(now, hot)) {
+			if (hot) return false;
+			now = last;
+		}
+		if (current != Phase::None) {
+			for (std::size_t i = 0; i < EventCount; ++i) {
+				auto &total = totals[std::size_t(current)][i];
+				total.store(total.load(std::memory_order_relaxed) + (now[i] - last[i]), std::memory_order_relaxed);
+			}
+		}
+		last	= now;
+		current = phase;
+		return true;
+	}
+
+	friend class Scope;
+
+   public:
+	/// @brief true if the counters are read without a syscall, see Scope::Scope()
+	inline bool isCheap() const {
+#ifdef BEAMCAST_PERF
+		return rdpmc;
+#else
+		return false;
+#endif
+	}
+
+	ThreadCounters() = default;
+	ThreadCounters(const ThreadCounters &)			  = delete;
+	ThreadCounters &operator=(const ThreadCounters &) = delete;
+
+	/// @brief Opens the counters of the calling thread
+	/// @return false if the kernel does not provide them
+	bool open() {
+#ifdef BEAMCAST_PERF
+		fds.fill(-1);
+		for (std::size_t i = 0; i < EventCount; ++i) {
+			perf_event_attr attr{};
+			attr.size			= sizeof(attr);
+			attr.type			= PERF_TYPE_HARDWARE;
+			attr.config			= CONFIGS[i];
+			attr.read_format	= PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.disabled		= i == 0;
+			// user space only, which is all a paranoid level of 2 allows and all the renderer runs
+			attr.exclude_kernel = 1;
+			attr.exclude_hv		= 1;
+			fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+			if (fds[i] < 0) {
+				const int error = errno;
+				close();
+				dbLog(dbg::LOG_WARNING, "Hardware counters are not available (perf_event_open: ", std::strerror(error),
+					  "), they are not measured");
+				return false;
+			}
+		}
+		for (std::size_t i = 0; i < EventCount; ++i) {
+			void *page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fds[i], 0);
+			if (page == MAP_FAILED) {
+				rdpmc = false;
+				break;
+			}
+			pages[i] = static_cast<const perf_event_mmap_page *>(page);
+		}
+		ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		read(last, false);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void close() {
+#ifdef BEAMCAST_PERF
+		for (std::size_t i = 0; i < EventCount; ++i) {
+			if (pages[i]) munmap(const_cast<perf_event_mmap_page *>(pages[i]), sysconf(_SC_PAGESIZE));
+			if (fds[i] >= 0) ::close(fds[i]);
+			pages[i] = nullptr;
+			fds[i]	 = -1;
+		}
+#endif
+	}
+
+	~ThreadCounters() { close(); }
+
+	/// @brief Nanoseconds the counters were enabled and running as of the last read
+	std::pair<uint64_t, uint64_t> times() const {
+		return {timeEnabled.load(std::memory_order_relaxed), timeRunning.load(std::memory_order_relaxed)};
+	}
+
+	Counts get(Phase phase) const {
+		Counts counts;
+		for (std::size_t i = 0; i < EventCount; ++i) {
+			counts[i] = totals[std::size_t(phase)][i].load(std::memory_order_relaxed);
+		}
+		return counts;
+	}
+};
+
+/// Counters of all threads, kept after their thread exits
+struct Registry {
+	std::mutex									 mutex;
+	std::vector<std::shared_ptr<ThreadCounters>> threads;
+	std::atomic_bool							 unavailable = false;	  ///< set when opening failed once
+};
+
+inline Registry &registry() {
+	static Registry r;
+	return r;
+}
+
+/// @brief The counters of the calling thread, opened when it is first called, nullptr if they are not available
+inline ThreadCounters *local() {
+	if constexpr (!ENABLED) return nullptr;
+	static thread_local ThreadCounters *counters = []() -> ThreadCounters * {
+		auto &r = registry();
+		if (r.unavailable.load(std::memory_order_relaxed)) return nullptr;
+		auto c = std::make_shared<ThreadCounters>();
+		if (!c->open()) {
+			r.unavailable.store(true, std::memory_order_relaxed);
+			return nullptr;
+		}
+		std::lock_guard lock(r.mutex);
+		r.threads.push_back(c);
+		return c.get();
+	}();
+	return counters;
+}
+
+/// Attributes what the calling thread does while it lives to \a phase
+class Scope {
+	ThreadCounters *counters = nullptr;
+	Phase			previous = Phase::None;
+	bool			hot		 = false;
+
+   public:
+	/// @param hot - the scope is entered so often, like once per ray, that it only counts while the counters are
+	/// read with rdpmc
+	explicit Scope(Phase phase, bool hot = false) : hot(hot) {
+		if constexpr (ENABLED) {
+			counters = local();
+			if (counters && hot && !counters->isCheap()) counters = nullptr;
+			if (!counters) return;
+			previous = counters->current;
+			if (!counters->enter(phase, hot)) counters = nullptr;
+		}
+	}
+	~Scope() {
+		if constexpr (ENABLED) {
+			// the counts of a hot scope that cannot read the counters when it ends go to the enclosing phase
+			if (counters && !counters->enter(previous, hot)) counters->current = previous;
+		}
+	}
+	Scope(const Scope &)			= delete;
+	Scope &operator=(const Scope &) = delete;
+};
+
+/// @brief Counts of all threads per phase since the start of the program
+inline std::array<Counts, std::size_t(Phase::Count)> summary() {
+	std::array<Counts, std::size_t(Phase::Count)> sums{};
+	auto										 &r = registry();
+	std::lock_guard								  lock(r.mutex);
+	for (const auto &thread : r.threads) {
+		for (std::size_t phase = 0; phase < sums.size(); ++phase) {
+			const Counts counts = thread->get(Phase(phase));
+			for (std::size_t i = 0; i < EventCount; ++i) sums[phase][i] += counts[i];
+		}
+	}
+	return sums;
+}
+
+/// @brief Share of the time the counters of all threads were enabled that they were counting, below 1 while the
+/// kernel multiplexed them with other perf events
+inline float runningShare() {
+	uint64_t		enabled = 0, running = 0;
+	auto		   &r		= registry();
+	std::lock_guard lock(r.mutex);
+	for (const auto &thread : r.threads) {
+		const auto [e, t] = thread->times();
+		enabled += e;
+		running += t;
+	}
+	return enabled ? float(running) / enabled : 1.f;
+}
+
+/// @brief Logs the summary() per phase: share of the cycles, instructions per cycle and misses per 1000 instructions
+inline void logSummary() {
+	if constexpr (ENABLED) {
+		if (registry().unavailable.load(std::memory_order_relaxed)) return;
+		const auto sums		   = summary();
+		uint64_t   totalCycles = 0;
+		for (const auto &counts : sums) totalCycles += counts[Cycles];
+		if (totalCycles == 0) return;
+
+		dbLog(dbg::LOG_INFO, "Hardware counters of all threads so far, user space:");
+		for (std::size_t phase = std::size_t(Phase::Build); phase < sums.size(); ++phase) {
+			const Counts &c = sums[phase];
+			if (c[Cycles] == 0) continue;
+			const float instructions = std::max<float>(c[Instructions], 1.f);
+			dbLog(dbg::LOG_INFO, "  ", PHASE_NAMES[phase], ": ", 100.f * c[Cycles] / totalCycles, "% of ",
+				  totalCycles / 1e6f, " M cycles, IPC ", float(c[Instructions]) / c[Cycles], ", ",
+				  1000.f * c[CacheMisses] / instructions, " cache and ", 1000.f * c[BranchMisses] / instructions,
+				  " branch misses per 1000 instructions");
+		}
+		if (const float share = runningShare(); share < 0.99f) {
+			dbLog(dbg::LOG_WARNING, "The hardware counters were shared with other perf events and only counted ",
+				  100.f * share, "% of the time, the counts are partial");
+		}
+	}
+}
+}	  // namespace perf
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <img/export.hpp>
+#include <img/image.hpp>
+#include <log.hpp>
+
+/**
+ * Writes preview images of a progressive render from a background thread.
+ * Every \a interval the thread raises a request flag. The render loop checks it between passes with
+ * wantsSnapshot() and hands over a resolved copy of the image with submit(). Encoding and writing happen on
+ * the background thread, so the render workers never wait for the disk. The extension of the filename picks PNG, PFM
+ * or EXR, and a preview that fails to write is logged and skipped.
+ */
+class PreviewWriter {
+	std::string					 filename;
+	std::chrono::duration<float> interval;
+
+	std::thread				thread;
+	std::mutex				mutex;
+	std::condition_variable cv;
+	std::atomic_bool		requested = false;
+	bool					stopping  = false;
+	bool					ready	  = false;
+	Image<RGBA32F>			snapshot;
+
+	/// in the format given by the extension of the filename, like Renderer::saveImage()
+	void write(const Image<RGBA32F> &img) const {
+		switch (imageFormatFromFilename(filename)) {
+			case ImageFormat::PNG: exportToFile<export_PNG>(img, filename); break;
+			case ImageFormat::PFM: exportToFile<export_PFM<RGBA32F>>(img, filename); break;
+			case ImageFormat::EXR: exportToFile<export_EXR<RGBA32F>>(img, filename); break;
+		}
+	}
+
+	void run() {
+		std::unique_lock lock(mutex);
+		while (!stopping) {
+			cv.wait_for(lock, interval, [this]() { return stopping; });
+			if (stopping) break;
+
+			requested.store(true, std::memory_order_relaxed);
+			cv.wait(lock, [this]() { return stopping || ready; });
+			if (!ready) break;
+
+			Image<RGBA32F> img = std::move(snapshot);
+			ready			   = false;
+			lock.unlock();
+			// a preview that cannot be written is skipped, the render goes on and the next one is tried again
+			try {
+				write(img);
+				dbLog(dbg::LOG_DEBUG, "Preview saved to ", filename);
+			} catch (const std::exception &e) {
+				dbLog(dbg::LOG_ERROR, "Failed to write preview ", filename, ": ", e.what());
+			}
+			lock.lock();
+		}
+	}
+
+   public:
+	PreviewWriter(const std::string &filename, float intervalSeconds)
+		: filename(filename), interval(intervalSeconds) {
+		if (intervalSeconds <= 0.f) { throw std::runtime_error("Preview interval must be greater than 0"); }
+		thread = std::thread(&PreviewWriter::run, this);
+	}
+
+	PreviewWriter(const PreviewWriter &)			= delete;
+	PreviewWriter &operator=(const PreviewWriter &) = delete;
+
+	~PreviewWriter() {
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		cv.notify_all();
+		if (thread.joinable()) thread.join();
+	}
+
+	/// @brief true when the background thread is waiting for a new image
+	inline bool wantsSnapshot() const { return requested.load(std::memory_order_relaxed); }
+
+	/// @brief hand over an image to be written, clears the request flag
+	void submit(const Image<RGBA32F> &img) {
+		{
+			std::lock_guard lock(mutex);
+			snapshot = img;
+			ready	 = true;
+			requested.store(false, std::memory_order_relaxed);
+		}
+		cv.notify_all();
+	}
+};
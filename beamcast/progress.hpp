@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <log.hpp>
+
+enum class ProgressFormat { Bar, JSON, Off };
+
+inline ProgressFormat progressFormatFromString(std::string_view name) {
+	if (name == "bar") return ProgressFormat::Bar;
+	if (name == "json") return ProgressFormat::JSON;
+	if (name == "off") return ProgressFormat::Off;
+	throw std::runtime_error("Unknown progress format: " + std::string(name));
+}
+
+/**
+ * Reports the progress of a render from its own thread. Render threads only count the tiles and rays they finished
+ * in counters of their own with step(), without any shared cache line, lock or output. The reporter sums them every
+ * Settings::interval seconds and prints the tiles done, rays per second and the estimated time left, as a status line
+ * or as one JSON object per line for other programs. finish() reports the time and throughput per frame.
+ *
+ * Progressive and time budget renders do not know their tile count up front. Their reporter is made without one and
+ * told the samples per pixel and the fraction of the render done after every pass with passDone().
+ */
+class ProgressReporter {
+   public:
+	struct Settings {
+		ProgressFormat format	= ProgressFormat::Bar;
+		float		   interval = 0.5f;			 ///< seconds between reports
+		std::ostream  *json		= &std::cout;	 ///< where ProgressFormat::JSON lines go
+	};
+
+   private:
+	/// counters of one thread, only written by it and on their own cache line
+	struct alignas(64) Slot {
+		std::atomic_uint64_t tiles = 0;
+		std::atomic_uint64_t rays  = 0;
+	};
+
+	struct Totals {
+		uint64_t tiles = 0;
+		uint64_t rays  = 0;
+	};
+
+	struct Registry {
+		std::mutex						   mutex;
+		std::vector<std::shared_ptr<Slot>> slots;	  ///< kept after their thread exits
+	};
+
+	static Registry &registry() {
+		static Registry r;
+		return r;
+	}
+
+	static Slot &local() {
+		static thread_local std::shared_ptr<Slot> slot = [] {
+			auto			s = std::make_shared<Slot>();
+			auto		   &r = registry();
+			std::lock_guard lock(r.mutex);
+			r.slots.push_back(s);
+			return s;
+		}();
+		return *slot;
+	}
+
+	/// @brief Sums the counters of all threads, they only ever grow
+	static Totals sum() {
+		Totals			t;
+		auto		   &r = registry();
+		std::lock_guard lock(r.mutex);
+		for (const auto &slot : r.slots) {
+			t.tiles += slot->tiles.load(std::memory_order_relaxed);
+			t.rays += slot->rays.load(std::memory_order_relaxed);
+		}
+		return t;
+	}
+
+	std::string name;
+	uint64_t	totalTiles;
+	std::size_t frames;
+	bool		openEnded = false;	   ///< made without a tile count, see passDone()
+	Settings	settings;
+	Totals		start;
+	Timer		timer;
+
+	std::atomic_uint32_t samples  = 0;	   ///< per pixel, of an open ended render
+	std::atomic<float>	 fraction = -1.f;	  ///< of an open ended render, negative if unknown
+
+	std::mutex				mutex;
+	std::condition_variable cv;
+	bool					done = false;	 ///< guarded by mutex
+	std::thread				thread;
+
+	void reportPasses(bool final) {
+		const Totals   now			 = sum();
+		const uint64_t rays			 = now.rays - start.rays;
+		const float	   elapsed		 = timer.elapsed<std::chrono::microseconds>() / 1e6f;
+		const float	   raysPerSecond = rays / std::max(elapsed, 1e-6f);
+		const uint32_t spp			 = samples.load(std::memory_order_relaxed);
+		const float	   part			 = std::min(fraction.load(std::memory_order_relaxed), 1.f);
+		const bool	   knownETA		 = part > 0.f;
+		const float	   eta			 = knownETA ? elapsed * (1.f - part) / part : 0.f;
+
+		if (settings.format == ProgressFormat::JSON) {
+			auto &out = *settings.json;
+			out << "{\"event\":\"" << (final ? "done" : "progress") << "\",\"name\":\"" << name
+				<< "\",\"samples\":" << spp << ",\"elapsed\":" << elapsed << ",\"rays\":" << rays
+				<< ",\"rays_per_sec\":" << raysPerSecond;
+			if (final) out << ",\"fraction\":1";
+			else if (knownETA) out << ",\"fraction\":" << part << ",\"eta\":" << eta;
+			else out << ",\"fraction\":null,\"eta\":null";
+			out << "}" << std::endl;
+			return;
+		}
+		if (final) {
+			dbLog(dbg::LOG_INFO, name, ": ", spp, " spp in ", elapsed, " s, ", raysPerSecond / 1e6f, " Mrays/s");
+		} else if (knownETA) {
+			dbLogR(dbg::LOG_INFO, name, ": ", int(part * 100.f), "% (", spp, " spp), ", raysPerSecond / 1e6f,
+				   " Mrays/s, ETA ", eta, " s   ");
+		} else {
+			dbLogR(dbg::LOG_INFO, name, ": ", spp, " spp, ", elapsed, " s, ", raysPerSecond / 1e6f, " Mrays/s   ");
+		}
+	}
+
+	void report(bool final) {
+		if (openEnded) return reportPasses(final);
+		const Totals  now	  = sum();
+		const uint64_t tiles  = std::min(now.tiles - start.tiles, totalTiles);
+		const uint64_t rays	  = now.rays - start.rays;
+		const float	   elapsed = timer.elapsed<std::chrono::microseconds>() / 1e6f;
+		const float	   raysPerSecond = rays / std::max(elapsed, 1e-6f);
+		const float	   fraction		 = totalTiles ? float(tiles) / totalTiles : 1.f;
+		// the estimate needs a finished tile, before that it is unknown
+		const bool	   knownETA		 = tiles > 0;
+		const float	   eta			 = knownETA ? elapsed * (totalTiles - tiles) / tiles : 0.f;
+
+		if (settings.format == ProgressFormat::JSON) {
+			auto &out = *settings.json;
+			out << "{\"event\":\"" << (final ? "done" : "progress") << "\",\"name\":\"" << name
+				<< "\",\"tiles\":" << tiles << ",\"total_tiles\":" << totalTiles << ",\"fraction\":" << fraction
+				<< ",\"elapsed\":" << elapsed << ",\"rays\":" << rays << ",\"rays_per_sec\":" << raysPerSecond;
+			if (final) {
+				out << ",\"frames\":" << frames << ",\"seconds_per_frame\":" << elapsed / std::max<std::size_t>(frames, 1);
+			} else if (knownETA) out << ",\"eta\":" << eta;
+			else out << ",\"eta\":null";
+			out << "}" << std::endl;
+			return;
+		}
+		if (final) {
+			dbLog(dbg::LOG_INFO, name, ": 100% (", tiles, " tiles), ", frames, frames == 1 ? " frame in " : " frames in ",
+				  elapsed, " s, ", elapsed / std::max<std::size_t>(frames, 1), " s per frame, ", raysPerSecond / 1e6f,
+				  " Mrays/s");
+		} else if (knownETA) {
+			dbLogR(dbg::LOG_INFO, name, ": ", int(fraction * 100.f), "% (", tiles, "/", totalTiles, " tiles), ",
+				   raysPerSecond / 1e6f, " Mrays/s, ETA ", eta, " s   ");
+		} else {
+			dbLogR(dbg::LOG_INFO, name, ": 0% (0/", totalTiles, " tiles)");
+		}
+	}
+
+	void run() {
+		std::unique_lock lock(mutex);
+		const auto		 interval = std::chrono::duration<float>(std::max(settings.interval, 0.01f));
+		while (!cv.wait_for(lock, interval, [this]() { return done; })) {
+			lock.unlock();
+			report(false);
+			lock.lock();
+		}
+	}
+
+   public:
+	/// @param totalTiles - tile jobs of the render, of all its frames
+	/// @param frames - frames rendered at once, the throughput is reported per frame
+	ProgressReporter(std::string name, uint64_t totalTiles, std::size_t frames, const Settings &settings)
+		: name(std::move(name)), totalTiles(totalTiles), frames(frames), settings(settings), start(sum()) {
+		if (settings.format == ProgressFormat::Off) return;
+		report(false);
+		thread = std::thread(&ProgressReporter::run, this);
+	}
+
+	/// @brief Reporter of a render whose tile count is not known, see passDone()
+	ProgressReporter(std::string name, const Settings &settings)
+		: name(std::move(name)), totalTiles(0), frames(1), openEnded(true), settings(settings), start(sum()) {
+		if (settings.format == ProgressFormat::Off) return;
+		report(false);
+		thread = std::thread(&ProgressReporter::run, this);
+	}
+
+	ProgressReporter(const ProgressReporter &)			  = delete;
+	ProgressReporter &operator=(const ProgressReporter &) = delete;
+
+	~ProgressReporter() { finish(); }
+
+	/// @brief Counts a finished tile of the calling thread with the \a rays it traced
+	static void step(uint64_t rays) {
+		auto &slot = local();
+		slot.tiles.store(slot.tiles.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		slot.rays.store(slot.rays.load(std::memory_order_relaxed) + rays, std::memory_order_relaxed);
+	}
+
+	/// @brief Rays traced by all threads since the start of the program, as counted by step()
+	static uint64_t raysTraced() { return sum().rays; }
+
+	/// @brief Reports that an open ended render has \a spp samples per pixel after a pass
+	/// @param part - fraction of the render done, the larger of the fractions of its limits, negative without limits
+	void passDone(uint32_t spp, float part) {
+		samples.store(spp, std::memory_order_relaxed);
+		fraction.store(part, std::memory_order_relaxed);
+	}
+
+	/// @brief Stops reporting and reports the totals of the render, only the first call does anything
+	void finish() {
+		{
+			std::lock_guard lock(mutex);
+			if (done) return;
+			done = true;
+		}
+		cv.notify_all();
+		if (thread.joinable()) thread.join();
+		if (settings.format != ProgressFormat::Off) report(true);
+	}
+};
@@ -1,21 +1,74 @@
 #pragma once
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+
 #include <threading.hpp>
+#include <accumulation.hpp>
 #include <img/image.hpp>
 #include <data.hpp>
 #include <scene.hpp>
 #include <log.hpp>
+#include <preview.hpp>
+#include <progress.hpp>
+#include <tiles.hpp>
+#include <denoise.hpp>
+#include <perf.hpp>
+#include <trace.hpp>
 #include "sample.hpp"
 
 class Renderer {
 	OneShotThreadPool pool;
 	Image<RGBA32F>	  image;
+	AccumulationBuffer accumulation;	///< sum and number of all samples taken per pixel
+	FeatureBuffers	  features;			///< denoiser guides, only collected when denoising
+	FeatureBuffers	  aovs;				///< primary hit features, only collected when AOVs are enabled
+	bool			  collectingAOVs = false;
+	bool			  denoising = false;
+	DenoiseSettings	  denoiseSettings;
+	int				  samplesTaken = 0;	///< samples per pixel added by all passes so far
+	SamplerType		  samplerType  = SamplerType::Sobol;
+	uint32_t		  seed		   = 0;	///< decorrelates the sample sequences of different frames
+	uint64_t		  raysAtClear  = 0;	///< ProgressReporter::raysTraced() at the last clearAccumulation()
+	stats::Counters	  statistics;		///< totals of the tiles rendered since then, only with BEAMCAST_STATS
+	std::mutex		  statisticsMutex;
+	TileScheduler	  tiles;
+	ProgressReporter::Settings progressSettings;
 	float			  resolution_scale = 1.0f;
 	int spp;
 
+	std::atomic_bool stopRequested = false;
+
 	Scene &scene;
 
    public:
+	/// Settings for renderProgressive()
+	struct ProgressiveSettings {
+		int			maxSamples		= 0;	   ///< stop after this many samples per pixel, 0 for no limit
+		float		timeLimit		= 0.f;	   ///< stop after this many seconds, 0 for no limit
+		float		previewInterval = 0.f;	   ///< seconds between preview images, 0 disables previews
+		std::string previewFile		= "preview.png";
+		float		checkpointInterval = 0.f;	  ///< seconds between checkpoints, 0 only writes one when stopped
+		std::string checkpointFile;				  ///< resume from and save checkpoints to this file if not empty
+	};
+
+	/// Header of a checkpoint file. It is followed by the blocks of the accumulation buffer.
+	struct CheckpointHeader {
+		char	 magic[4]	  = {'B', 'C', 'C', 'P'};
+		uint32_t version	  = 5;
+		uint32_t width		  = 0;
+		uint32_t height		  = 0;
+		uint32_t samplesTaken = 0;
+		uint32_t seed		  = 0;
+		uint32_t maxSamples	  = 0;	   ///< sample limit of the render, 0 for none
+		uint32_t padding	  = 0;
+		uint64_t sceneHash	  = 0;	   ///< Scene::fileHash of the scene rendered
+	};
+
 	Renderer(Scene &scene, float resolution_scale = 1.0f, int threadCount = std::thread::hardware_concurrency(), int spp = 1)
 		: pool(threadCount), resolution_scale(resolution_scale), spp(spp), scene(scene) {
 		setResolutionScale(resolution_scale);
@@ -26,59 +79,465 @@ class Renderer {
 		resolution_scale		  = scale;
 		const auto &imageSettings = scene.imageSettings;
 		image.resize(imageSettings.resolution.x * resolution_scale, imageSettings.resolution.y * resolution_scale);
+		accumulation.resize(image.getWidth(), image.getHeight());
+		if (denoising) features.resize(image.getWidth(), image.getHeight());
+		if (collectingAOVs) aovs.resize(image.getWidth(), image.getHeight());
+		tiles.configure(image.resolution(), pool.getNumThreads());
+	}
+
+	/// @brief Sets the tile size in pixels (0 picks it automatically) and the order tiles are rendered in
+	void setTiling(int tileSize, TileOrder order) {
+		tiles.setTiling(tileSize, order);
+		tiles.configure(image.resolution(), pool.getNumThreads());
+	}
+
+	void setSampler(SamplerType type) { samplerType = type; }
+
+	/// @brief Sets how render() and renderFrames() report their progress
+	void setProgress(const ProgressReporter::Settings &settings) { progressSettings = settings; }
+
+	/// @brief Sets the seed of the sample sequences, frames of an animation should use different seeds
+	void setSeed(uint32_t seed) { this->seed = seed; }
+
+	/// @brief Enables the denoiser on the final image of every render. Collects the feature buffers it needs.
+	void setDenoise(bool enabled, const DenoiseSettings &settings = {}) {
+		denoising		= enabled;
+		denoiseSettings = settings;
+		if (enabled) features.resize(image.getWidth(), image.getHeight());
+		else features.resize(0, 0);
 	}
 
+	/// @brief Enables collecting the primary hit data read by getAOV()
+	void setAOVs(bool enabled) {
+		collectingAOVs = enabled;
+		if (enabled) aovs.resize(image.getWidth(), image.getHeight());
+		else aovs.resize(0, 0);
+	}
+
+	/// @brief Resolves \a aov of the last render, see resolveAOV(). Requires setAOVs(true) before rendering.
+	Image<RGBA32F> getAOV(AOV aov) const {
+		if (!collectingAOVs) { throw std::runtime_error("AOVs were not collected"); }
+		Image<RGBA32F>	out;
+		Image<uint32_t> counts;
+		accumulation.resolveCounts(counts);
+		resolveAOV(aov, aovs, counts, out);
+		return out;
+	}
+
+	/// @brief Renders the frame with \a spp samples per pixel
 	void render() {
-		auto		  I = segmentImage(image.resolution(), ivec2(32, 32));
-		PercentLogger logger("Rendering", I.size());
-		scene.camera.setResolution(image.resolution());
-		pool.reset();
+		clearAccumulation();
+		ProgressReporter progress("Rendering", tileCount(), 1, progressSettings);
+		renderPass(spp);
+		progress.finish();
+		finish();
+		logStatistics();
+	};
 
-		auto f = [&](const std::any &job) {
-			auto segment = std::any_cast<std::pair<ivec2, ivec2>>(job);
-			uint32_t seed = rand();
-			for (const auto &coord : iter2D(segment.first, segment.second)) {
-				RGBA32F color = 0;
-				for (int i = 0; i < spp; ++i) {
-					color += shadePixel(coord, seed);
-				}
-				color /= (float)spp;	 // Average over 10 samples
-				color					= clamp(color, 0.f, 1.f);
-				image(coord.x, coord.y) = color;
+	/**
+	 * @brief Renders the frame one sample per pixel at a time until a limit in \a settings is reached or
+	 * requestStop() is called. When previews are enabled, the current estimate is written to
+	 * settings.previewFile periodically from a background thread.
+	 *
+	 * When settings.checkpointFile is set and exists, the render continues from it. The checkpoint is
+	 * rewritten every settings.checkpointInterval seconds and when the render is stopped early.
+	 */
+	void renderProgressive(const ProgressiveSettings &settings) {
+		if (settings.maxSamples <= 0 && settings.timeLimit <= 0.f) {
+			dbLog(dbg::LOG_WARNING, "Progressive render without sample or time limit, stop it with Ctrl+C");
+		}
+		const bool checkpointing = !settings.checkpointFile.empty();
+		if (!checkpointing || !loadCheckpoint(settings.checkpointFile, settings.maxSamples)) clearAccumulation();
+		stopRequested.store(false, std::memory_order_relaxed);
+
+		std::unique_ptr<PreviewWriter> preview;
+		if (settings.previewInterval > 0.f) {
+			preview = std::make_unique<PreviewWriter>(settings.previewFile, settings.previewInterval);
+		}
+
+		Timer			 timer, checkpointTimer;
+		ProgressReporter progress("Progressive", progressSettings);
+		while (settings.maxSamples <= 0 || samplesTaken < settings.maxSamples) {
+			renderPass(1);
+
+			float elapsed = timer.elapsed<std::chrono::milliseconds>() / 1000.f;
+			float part	  = -1.f;
+			if (settings.maxSamples > 0) part = float(samplesTaken) / settings.maxSamples;
+			if (settings.timeLimit > 0.f) part = std::max(part, elapsed / settings.timeLimit);
+			progress.passDone(samplesTaken, part);
+
+			if (settings.maxSamples > 0 && samplesTaken >= settings.maxSamples) break;
+			if (settings.timeLimit > 0.f && elapsed >= settings.timeLimit) break;
+			if (stopRequested.load(std::memory_order_relaxed)) break;
+
+			if (checkpointing && settings.checkpointInterval > 0.f &&
+				checkpointTimer.elapsed<std::chrono::milliseconds>() >= settings.checkpointInterval * 1000.f) {
+				saveCheckpoint(settings.checkpointFile, settings.maxSamples);
+				checkpointTimer.reset();
 			}
-			logger.step();
+			if (preview && preview->wantsSnapshot()) {
+				resolve();
+				preview->submit(image);
+			}
+		}
+		progress.finish();
+		finish();
+		if (checkpointing && wasStopped()) saveCheckpoint(settings.checkpointFile, settings.maxSamples);
+		logThroughput("Progressive render", timer);
+		logStatistics();
+	}
+
+	/**
+	 * @brief Renders the frame within \a budgetSeconds of wall time. The throughput is measured on the first
+	 * one sample pass and refined after every pass. The remaining budget is spent in a few larger passes, each
+	 * adding the same number of samples to every pixel, so the image is evenly converged when the deadline is
+	 * reached. A pass that is not expected to finish before the deadline is never started.
+	 */
+	void renderTimeBudget(float budgetSeconds) {
+		if (budgetSeconds <= 0.f) { throw std::runtime_error("Time budget must be greater than 0"); }
+		clearAccumulation();
+		stopRequested.store(false, std::memory_order_relaxed);
+
+		Timer			 timer;
+		ProgressReporter progress("Time budget", progressSettings);
+		renderPass(1);
+		progress.passDone(samplesTaken, timer.elapsed<std::chrono::microseconds>() / 1e6f / budgetSeconds);
+		while (!stopRequested.load(std::memory_order_relaxed)) {
+			float elapsed	= timer.elapsed<std::chrono::microseconds>() / 1e6f;
+			float perSample = elapsed / samplesTaken;
+			int	  affordable = (budgetSeconds - elapsed) * BUDGET_SAFETY / perSample;
+			if (affordable < 1) break;
+
+			int samples = std::clamp(int(budgetSeconds / BUDGET_PASSES / perSample), 1, affordable);
+			renderPass(samples);
+			progress.passDone(samplesTaken, timer.elapsed<std::chrono::microseconds>() / 1e6f / budgetSeconds);
+		}
+		progress.finish();
+		finish();
+		logThroughput("Time budget render", timer);
+		logStatistics();
+	}
+
+	/**
+	 * @brief Renders several animation frames at once with \a spp samples per pixel. The tiles of all frames go
+	 * to the pool together, which keeps every thread busy when a single frame has fewer tiles than there are
+	 * threads. See framesPerBatch().
+	 * @param onFrame - called on the calling thread for every frame in order, with the frame index and its image.
+	 * getAOV() returns the AOVs of that frame during the call.
+	 */
+	void renderFrames(std::span<const int> frames, const std::function<void(int, const Image<RGBA32F> &)> &onFrame) {
+		struct FrameBuffers {
+			Camera			   camera;
+			AccumulationBuffer accumulation;
+			FeatureBuffers	   features;
+			FeatureBuffers	   aovs;
 		};
+		std::vector<FrameBuffers> batch(frames.size());
 
-		for (const auto &segment : I) {
-			pool.addJob(std::any(segment), f);
+		trace::Zone		   zone("Render frames", "frames", frames.size());
+		ProgressReporter   progress("Rendering", tileCount() * frames.size(), frames.size(), progressSettings);
+		std::vector<float> costs(tiles.size());
+		statistics = {};
+		pool.reset();
+		for (std::size_t i = 0; i < frames.size(); ++i) {
+			auto &buffers  = batch[i];
+			buffers.camera = scene.camera;
+			if (!buffers.camera.frames.empty()) buffers.camera.setFrame(frames[i]);
+			buffers.camera.setResolution(image.resolution());
+			buffers.accumulation.resize(image.getWidth(), image.getHeight());
+			if (denoising) {
+				buffers.features.resize(image.getWidth(), image.getHeight());
+				buffers.features.clear();
+			}
+			if (collectingAOVs) {
+				buffers.aovs.resize(image.getWidth(), image.getHeight());
+				buffers.aovs.clear();
+			}
+			// only the first frame measures, the next batch is ordered by its costs
+			addPassJobs(buffers.camera, buffers.accumulation, denoising ? &buffers.features : nullptr,
+						collectingAOVs ? &buffers.aovs : nullptr, spp, frames[i], i == 0 ? costs.data() : nullptr);
 		}
 		pool.start();
 		pool.wait();
+		progress.finish();
+		tiles.update(std::move(costs));
+		logStatistics();
 
-		logger.finish();
-	};
+		samplesTaken = spp;
+		for (std::size_t i = 0; i < frames.size(); ++i) {
+			finish(batch[i].accumulation, batch[i].features, image);
+			// makes getAOV() see this frame
+			std::swap(accumulation, batch[i].accumulation);
+			std::swap(aovs, batch[i].aovs);
+			onFrame(frames[i], image);
+		}
+	}
+
+	/// @brief how many frames renderFrames() should get at once to have a tile for every thread
+	std::size_t framesPerBatch() const { return std::max<std::size_t>(1, pool.getNumThreads() / tileCount()); }
+
+	const Image<RGBA32F> &getImage() const { return image; }
+
+	/// @brief Makes a running progressive render stop after the current pass. Safe to call from a signal handler.
+	void requestStop() { stopRequested.store(true, std::memory_order_relaxed); }
+
+	/// @brief true if the last render was cut short by requestStop()
+	bool wasStopped() const { return stopRequested.load(std::memory_order_relaxed); }
+
+	/// @brief Number of rays traced by the last render
+	std::uint64_t getRayCount() const { return ProgressReporter::raysTraced() - raysAtClear; }
+
+	/// @brief Writes the accumulated samples and the sampler seed to \a filename. The file is replaced atomically
+	/// and is on disk before it replaces the previous checkpoint.
+	/// @param maxSamples - sample limit of the render, a checkpoint is only resumed by a render with the same limit
+	void saveCheckpoint(const std::string &filename, int maxSamples = 0) const {
+		CheckpointHeader header;
+		header.width		= image.getWidth();
+		header.height		= image.getHeight();
+		header.samplesTaken = samplesTaken;
+		header.seed			= seed;
+		header.maxSamples	= std::max(maxSamples, 0);
+		header.sceneHash	= scene.fileHash;
 
-	void saveImage(const std::string_view &filename) const {
-		exportToFile<export_PNG>(image, filename);
+		const std::string tmp = filename + ".tmp";
+		{
+			std::ofstream out(tmp, std::ios::binary);
+			if (!out) { throw std::runtime_error("Failed to open checkpoint for writing: " + tmp); }
+			out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			accumulation.write(out);
+			out.flush();
+			if (!out) { throw std::runtime_error("Failed to write checkpoint: " + tmp); }
+		}
+		const int fd = ::open(tmp.c_str(), O_RDONLY | O_CLOEXEC);
+		const bool synced = fd >= 0 && ::fsync(fd) == 0;
+		if (fd >= 0) ::close(fd);
+		if (!synced) { throw std::runtime_error("Failed to sync checkpoint: " + tmp); }
+		std::filesystem::rename(tmp, filename);
+		dbLog(dbg::LOG_DEBUG, "Checkpoint saved to ", filename, " at ", samplesTaken, " spp");
+	}
+
+	/// @brief Restores the state written by saveCheckpoint().
+	/// @return false if the file does not exist or was written for a different scene, resolution or \a maxSamples
+	bool loadCheckpoint(const std::string &filename, int maxSamples = 0) {
+		std::ifstream in(filename, std::ios::binary);
+		if (!in) return false;
+
+		CheckpointHeader header, expected;
+		in.read(reinterpret_cast<char *>(&header), sizeof(header));
+		if (!in || std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+			header.version != expected.version) {
+			throw std::runtime_error("Invalid checkpoint file: " + filename);
+		}
+		if (header.width != image.getWidth() || header.height != image.getHeight()) {
+			dbLog(dbg::LOG_WARNING, "Ignoring checkpoint ", filename, " made for a resolution of ", header.width, "x",
+				  header.height);
+			return false;
+		}
+		if (header.sceneHash != scene.fileHash) {
+			dbLog(dbg::LOG_WARNING, "Ignoring checkpoint ", filename, " made for a different scene file");
+			return false;
+		}
+		if (header.maxSamples != uint32_t(std::max(maxSamples, 0))) {
+			dbLog(dbg::LOG_WARNING, "Ignoring checkpoint ", filename, " made for a limit of ", header.maxSamples, " spp");
+			return false;
+		}
+
+		accumulation.read(in);
+		if (!in) { throw std::runtime_error("Truncated checkpoint file: " + filename); }
+		// features are not saved, they are averaged over the samples taken after resuming
+		if (denoising) features.clear();
+		if (collectingAOVs) aovs.clear();
+		samplesTaken = header.samplesTaken;
+		seed		 = header.seed;
+		raysAtClear  = ProgressReporter::raysTraced();
+		dbLog(dbg::LOG_INFO, "Resuming from checkpoint ", filename, " at ", samplesTaken, " spp");
+		return true;
+	}
+
+	void saveImage(const std::string_view &filename) const { saveImage(image, filename); }
+
+	/**
+	 * @brief Saves \a img in the format given by the extension of \a filename (png, pfm or exr). PNG clamps the
+	 * colors to 8 bits, PFM and EXR keep the floats.
+	 * @param layers - AOVs from getAOV(), added as layers to EXR files and ignored by the other formats
+	 */
+	static void saveImage(const Image<RGBA32F> &img, const std::string_view &filename,
+						  std::span<const std::pair<AOV, Image<RGBA32F>>> layers = {}) {
+		trace::Zone zone("Save image");
+		perf::Scope scope(perf::Phase::Export);
+		switch (imageFormatFromFilename(filename)) {
+			case ImageFormat::PNG: exportToFile<export_PNG>(img, filename); break;
+			case ImageFormat::PFM: exportToFile<export_PFM<RGBA32F>>(img, filename); break;
+			case ImageFormat::EXR: {
+				std::ofstream out(std::string(filename), std::ios::binary);
+				if (!out) { throw std::runtime_error("Failed to open file for writing: " + std::string(filename)); }
+				ExrWriter writer(img.getWidth(), img.getHeight());
+				writer.addChannels(img, "", EXR_RGBA_CHANNELS);
+				for (const auto &[aov, layer] : layers) writer.addChannels(layer, aovName(aov), aovChannels(aov));
+				writer.write(out);
+				break;
+			}
+		}
 		dbLog(dbg::LOG_INFO, "Image saved to ", filename, "\n");
 	}
 
-	RGBA32F shadePixel(const ivec2 &pixel, uint32_t &seed) const {
-		const auto &x	= pixel.x;
-		const auto &y	= pixel.y;
-		auto		r	= scene.camera.generate_ray(ivec2(x, y), seed);
-		auto		hit = scene.intersect(r);
-		if (hit.t == std::numeric_limits<float>::max()) { return scene.backgroundColor; }
+	inline int getSamplesTaken() const { return samplesTaken; }
+
+	/// @param primary - filled with what the primary ray hit if not null
+	/// @param guide - filled with the features for the denoiser if not null, see traceFeatures()
+	RGBA32F shadePixel(const Camera &camera, const ivec2 &pixel, Sampler &sampler, PixelFeatures *primary = nullptr,
+					   PixelFeatures *guide = nullptr) const {
+		auto r	 = camera.generate_ray(pixel, sampler);
+		auto hit = scene.intersect(r);
+		if (hit.t == std::numeric_limits<float>::max()) {
+			const PixelFeatures background{vec3(0.f), 0.f, scene.backgroundColor.xyz()};
+			if (primary) *primary = background;
+			if (guide) *guide = background;
+			return scene.backgroundColor;
+		}
 
 		const auto &object		  = scene.getObjects()[hit.objectIndex];
 		auto		materialIndex = object->getMaterialIndex();
 		const auto &material	  = scene.materials[materialIndex];
 		scene.fillHitInfo(hit, r, material->smooth);
+		if (primary) {
+			*primary = PixelFeatures{hit.normal, hit.t, material->getAlbedo(hit), hit.objectIndex,
+									 uint32_t(materialIndex)};
+		}
+		if (guide) *guide = traceFeatures(hit, r, *material);
 
-		seed = pcg_hash(x + y * image.resolution().x + seed);
-
-		vec4 color = material->shade(hit, r, scene, seed);
+		vec4 color = material->shade(hit, r, scene, sampler);
 
 		return color;
 	}
+
+   private:
+	// specular surfaces followed to find the features of a pixel
+	static constexpr int   MAX_FEATURE_BOUNCES = 3;
+	static constexpr float FEATURE_RAY_OFFSET  = 1e-3f;
+	// fraction of the remaining time budget a pass may be predicted to take
+	static constexpr float BUDGET_SAFETY = 0.9f;
+	// the time budget is spent in about that many passes
+	static constexpr int BUDGET_PASSES = 8;
+
+	/// @brief Features of a primary hit. Mirrors and glass show what they reflect or refract, so their features are
+	/// taken from the first non specular surface along the specular direction, tinted by the surfaces on the way.
+	PixelFeatures traceFeatures(RayHit hit, Ray ray, const Material &hitMaterial) const {
+		const Material *material = &hitMaterial;
+		float			depth	 = hit.t;
+		vec3			tint	 = 1.f;
+		vec3			direction;
+		for (int bounce = 0; bounce < MAX_FEATURE_BOUNCES && material->getSpecularDirection(hit, ray, direction);
+			 ++bounce) {
+			tint *= material->getAlbedo(hit);
+			ray = Ray(hit.pos + direction * FEATURE_RAY_OFFSET, direction).continueCone(ray, hit.coneWidth);
+			hit = scene.intersect(ray, bounce + 1);
+			if (hit.t == std::numeric_limits<float>::max()) {
+				return PixelFeatures{vec3(0.f), 0.f, tint * scene.backgroundColor._xyz()};
+			}
+			material = scene.materials[scene.getObjects()[hit.objectIndex]->getMaterialIndex()].get();
+			scene.fillHitInfo(hit, ray, material->smooth);
+			depth += hit.t;
+		}
+		return PixelFeatures{hit.normal, depth, tint * material->getAlbedo(hit)};
+	}
+
+	/// tiles of a pass, configured whenever the resolution or the tiling changes
+	inline std::size_t tileCount() const { return tiles.size(); }
+
+	void clearAccumulation() {
+		accumulation.clear();
+		if (denoising) features.clear();
+		if (collectingAOVs) aovs.clear();
+		samplesTaken = 0;
+		raysAtClear  = ProgressReporter::raysTraced();
+		statistics = {};
+	}
+
+	/// @brief Logs the traversal statistics of the tiles rendered since clearAccumulation(), see stats.hpp, and the
+	/// hardware counters of the whole run so far, see perf.hpp, and the hits of the texture cache if there is one
+	void logStatistics() const {
+		if constexpr (stats::ENABLED) statistics.log();
+		perf::logSummary();
+		if (TextureCache *cache = scene.textureManager.getCache()) cache->logStatistics();
+	}
+
+	void logThroughput(const std::string_view &name, const Timer &timer) const {
+		auto  ms   = timer.elapsed<std::chrono::milliseconds>();
+		float rays = getRayCount();
+		dbLog(dbg::LOG_INFO, name, " finished with ", samplesTaken, " spp in ", ms, " ms, ",
+			  rays / std::max<float>(ms, 1) / 1000.f, " Mrays/s");
+	}
+
+	/// @brief Adds \a samples samples to every pixel of the accumulation buffer
+	void renderPass(int samples) {
+		trace::Zone zone("Render pass", "samples", samples);
+		scene.camera.setResolution(image.resolution());
+		std::vector<float> costs(tileCount());
+		pool.reset();
+		addPassJobs(scene.camera, accumulation, denoising ? &features : nullptr, collectingAOVs ? &aovs : nullptr,
+					samples, seed, costs.data());
+		pool.start();
+		pool.wait();
+		tiles.update(std::move(costs));
+
+		samplesTaken += samples;
+	}
+
+	/// @brief Queues one job per tile that adds \a samples samples per pixel seen through \a camera.
+	/// Samples continue the sequence of every pixel after the ones already in \a accum, so the result does not
+	/// depend on the tiling, the thread count or how the samples are split into passes.
+	/// When \a features or \a aovs are given, the denoiser or primary hit features of every sample are added to them.
+	/// When \a costs is given, the time taken by every tile is written to it by Tile::index. Finished tiles are counted
+	/// for the ProgressReporter.
+	/// All references must stay valid until the pool is done.
+	void addPassJobs(const Camera &camera, AccumulationBuffer &accum, FeatureBuffers *features, FeatureBuffers *aovs,
+					 int samples, uint32_t seed, float *costs = nullptr) {
+		auto f = [this, &camera, &accum, features, aovs, samples, seed, costs](const std::any &job) {
+			Timer		timer;
+			auto		tile = std::any_cast<Tile>(job);
+			trace::Zone zone("Tile", "tile", tile.index);
+			perf::Scope scope(perf::Phase::Shade);
+			auto raysBefore = Scene::raysTraced;
+			if constexpr (stats::ENABLED) stats::local() = {};
+			for (const auto &coord : iter2D(tile.min, tile.max)) {
+				RGBA32F		   color = 0;
+				const uint32_t first = accum.count(coord.x, coord.y);
+				for (int i = 0; i < samples; ++i) {
+					Sampler			 sampler(samplerType, uvec2(coord), first + i, seed);
+					PixelFeatures	 primary, guide;
+					stats::CostMeter meter;
+					color += shadePixel(camera, coord, sampler, aovs ? &primary : nullptr, features ? &guide : nullptr);
+					if (aovs) aovs->add(coord.x, coord.y, primary);
+					if (stats::ENABLED && aovs) aovs->cost(coord.x, coord.y) += meter.elapsed();
+					if (features) features->add(coord.x, coord.y, guide);
+				}
+				accum.add(coord.x, coord.y, color, samples);
+			}
+			const uint64_t rays = Scene::raysTraced - raysBefore;
+			if constexpr (stats::ENABLED) {
+				std::lock_guard lock(statisticsMutex);
+				statistics += std::exchange(stats::local(), {});
+			}
+			if (costs) costs[tile.index] = timer.elapsed<std::chrono::nanoseconds>() * 1e-9f;
+			ProgressReporter::step(rays);
+		};
+
+		for (const auto &tile : tiles.getTiles()) {
+			pool.addJob(std::any(tile), f);
+		}
+	}
+
+	/// @brief Averages the accumulation buffer into the output image
+	void resolve() { accumulation.resolve(image); }
+
+	/// @brief Like resolve(), but runs the denoiser when it is enabled. Used for the final image of a render.
+	void finish() { finish(accumulation, features, image); }
+
+	void finish(const AccumulationBuffer &accum, const FeatureBuffers &featureSums, Image<RGBA32F> &out) {
+		trace::Zone zone("Resolve");
+		perf::Scope scope(perf::Phase::Export);
+		accum.resolve(out);
+		if (denoising) Denoiser::denoise(out, featureSums, out, pool, denoiseSettings);
+	}
 };
@@ -1,15 +1,24 @@
 #pragma once
 
+#include <cmath>
 #include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <myglm/myglm.h>
 
-inline float RadicalInverse_VdC(uint32_t bits) {
+inline uint32_t reverseBits(uint32_t bits) {
 	bits = (bits << 16u) | (bits >> 16u);
 	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
 	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
 	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
 	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-	return float(bits) * 2.3283064365386963e-10;	 // / 0x100000000
+	return bits;
+}
+
+inline float RadicalInverse_VdC(uint32_t bits) {
+	return float(reverseBits(bits)) * 2.3283064365386963e-10;	  // / 0x100000000
 }
 
 inline auto hammersley(uint32_t i, uint32_t N) -> vec2 { return vec2(float(i) / float(N), RadicalInverse_VdC(i)); }
@@ -25,3 +34,180 @@ inline float randomFloat(uint32_t &seed) {
 	return float(seed) / float(0x7fffffff);
 }
 
+/// combines two hashes, from boost::hash_combine
+inline uint32_t hashCombine(uint32_t seed, uint32_t v) { return seed ^ (pcg_hash(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2)); }
+
+/// maps the upper 24 bits to [0, 1), never returns 1
+inline float toUnitFloat(uint32_t bits) { return float(bits >> 8) * 0x1p-24f; }
+
+/// second dimension of the Sobol sequence (the first one is reverseBits(index))
+inline uint32_t sobol2(uint32_t index) {
+	uint32_t result = 0;
+	for (uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1) {
+		if (index & 1) result ^= v;
+	}
+	return result;
+}
+
+/// hash based Owen scrambling
+/// Burley, "Practical Hash-based Owen Scrambling", JCGT 2020
+inline uint32_t nestedUniformScramble(uint32_t x, uint32_t seed) {
+	x = reverseBits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return reverseBits(x);
+}
+
+/**
+ * 64x64 tileable blue noise mask with values in [0, 1), made with the void and cluster method on first use.
+ * Ulichney, "The void-and-cluster method for dither array generation", 1993
+ */
+inline const std::vector<float> &blueNoiseTile() {
+	static const std::vector<float> tile = []() {
+		constexpr int	N = 64, R = 6;
+		constexpr float sigma = 1.5f;
+
+		float kernel[2 * R + 1][2 * R + 1];
+		for (int dy = -R; dy <= R; ++dy)
+			for (int dx = -R; dx <= R; ++dx)
+				kernel[dy + R][dx + R] = std::exp(-(dx * dx + dy * dy) / (2.f * sigma * sigma));
+
+		std::vector<float> energy(N * N, 0.f);
+		std::vector<bool>  set(N * N, false);
+		auto			   splat = [&](int p, float sign) {
+			  int x = p % N, y = p / N;
+			  for (int dy = -R; dy <= R; ++dy)
+				  for (int dx = -R; dx <= R; ++dx)
+					  energy[((y + dy + N) % N) * N + (x + dx + N) % N] += sign * kernel[dy + R][dx + R];
+		};
+		auto tightestCluster = [&]() {
+			int best = -1;
+			for (int i = 0; i < N * N; ++i)
+				if (set[i] && (best < 0 || energy[i] > energy[best])) best = i;
+			return best;
+		};
+		auto largestVoid = [&]() {
+			int best = -1;
+			for (int i = 0; i < N * N; ++i)
+				if (!set[i] && (best < 0 || energy[i] < energy[best])) best = i;
+			return best;
+		};
+
+		// random initial pattern, relaxed until moving the tightest cluster would not fill a larger void
+		uint32_t state = 1;
+		int		 ones  = 0;
+		while (ones < N * N / 10) {
+			state = pcg_hash(state);
+			if (!set[state % (N * N)]) {
+				set[state % (N * N)] = true;
+				splat(state % (N * N), 1.f);
+				++ones;
+			}
+		}
+		for (int i = 0; i < N * N; ++i) {
+			int cluster = tightestCluster();
+			set[cluster] = false;
+			splat(cluster, -1.f);
+			int hole = largestVoid();
+			set[hole] = true;
+			splat(hole, 1.f);
+			if (hole == cluster) break;
+		}
+
+		std::vector<int>  rank(N * N);
+		std::vector<bool> initial = set;
+		std::vector<float> initialEnergy = energy;
+		for (int r = ones - 1; r >= 0; --r) {
+			int cluster	  = tightestCluster();
+			rank[cluster] = r;
+			set[cluster]  = false;
+			splat(cluster, -1.f);
+		}
+		set	   = std::move(initial);
+		energy = std::move(initialEnergy);
+		for (int r = ones; r < N * N; ++r) {
+			int hole   = largestVoid();
+			rank[hole] = r;
+			set[hole]  = true;
+			splat(hole, 1.f);
+		}
+
+		std::vector<float> result(N * N);
+		for (int i = 0; i < N * N; ++i)
+			result[i] = (rank[i] + 0.5f) / float(N * N);
+		return result;
+	}();
+	return tile;
+}
+
+enum class SamplerType {
+	Random,		   ///< independent hashed random numbers
+	Sobol,		   ///< Owen scrambled Sobol points, decorrelated per pixel
+	BlueNoise,	   ///< one Sobol sequence for all pixels, shifted per pixel by a blue noise mask
+};
+
+inline SamplerType samplerTypeFromString(std::string_view name) {
+	if (name == "random") return SamplerType::Random;
+	if (name == "sobol") return SamplerType::Sobol;
+	if (name == "bluenoise") return SamplerType::BlueNoise;
+	throw std::runtime_error("Unknown sampler: " + std::string(name));
+}
+
+/**
+ * Source of the random numbers for one sample of one pixel.
+ *
+ * Every value depends only on the pixel, the index of the sample in that pixel, the dimension (how many values
+ * were drawn before it) and a seed, never on which thread renders the pixel or when. Rendering is therefore
+ * repeatable for any thread count, tile size or tile order, and a progressive render continues the same
+ * sequence where the previous pass stopped.
+ *
+ * Dimensions are consumed in pairs, get1D() uses the first half of a pair.
+ */
+class Sampler {
+	SamplerType type;
+	uvec2		pixel;
+	uint32_t	pixelSeed;
+	uint32_t	index;
+	uint32_t	dimension = 0;
+
+	inline vec2 sobol(uint32_t seed) const {
+		uint32_t i = nestedUniformScramble(index, seed);
+		return vec2(toUnitFloat(nestedUniformScramble(reverseBits(i), hashCombine(seed, 0))),
+					toUnitFloat(nestedUniformScramble(sobol2(i), hashCombine(seed, 1))));
+	}
+
+	inline float blueNoise(uint32_t dim) const {
+		constexpr uint32_t N	  = 64;
+		const uint32_t	   offset = pcg_hash(dim);
+		return blueNoiseTile()[((pixel.y + (offset >> 16)) % N) * N + (pixel.x + offset) % N];
+	}
+
+   public:
+	Sampler(SamplerType type, uvec2 pixel, uint32_t index, uint32_t seed)
+		: type(type), pixel(pixel), pixelSeed(hashCombine(hashCombine(seed, pixel.x), pixel.y)), index(index) {
+		// the sequence of the blue noise sampler is shared by all pixels
+		if (type == SamplerType::BlueNoise) pixelSeed = seed;
+	}
+
+	inline vec2 get2D() {
+		const uint32_t dim	= dimension;
+		const uint32_t seed = hashCombine(pixelSeed, dim);
+		dimension += 2;
+		switch (type) {
+			case SamplerType::Random: {
+				uint32_t h = pcg_hash(hashCombine(seed, index));
+				return vec2(toUnitFloat(h), toUnitFloat(pcg_hash(h)));
+			}
+			case SamplerType::BlueNoise: {
+				vec2 u = sobol(seed) + vec2(blueNoise(dim), blueNoise(dim + 1));
+				return vec2(u.x - std::floor(u.x), u.y - std::floor(u.y));
+			}
+			default: return sobol(seed);
+		}
+	}
+
+	inline float get1D() { return get2D().x; }
+};
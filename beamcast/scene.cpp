@@ -1,12 +1,28 @@
+#include <fstream>
+
+#include <hash.hpp>
 #include <scene.hpp>
 #include "json/json.hpp"
 #include "mesh.hpp"
+#include "trace.hpp"
+
+/// FNV-1a hash of the contents of \a filename
+static uint64_t hashFile(const std::string_view &filename) {
+	std::ifstream in{std::string(filename), std::ios::binary};
+	return fnv1a::hash(in);
+}
 
-Scene::Scene(const std::string_view &filename) {
+Scene::Scene(const std::string_view &filename, const TextureManager::Settings &textureSettings)
+	: textureManager(textureSettings) {
 	dbLog(dbg::LOG_DEBUG, "Loading scene from file: ", filename);
 	this->scenePath = filename;
+	this->fileHash	= hashFile(filename);
+	trace::Zone zone("Load scene");
 	try {
-		auto json = JSONFromFile(filename);
+		auto json = [&] {
+			trace::Zone zone("Parse JSON");
+			return JSONFromFile(filename);
+		}();
 		dbLog(dbg::LOG_DEBUG, "Parsed JSON from scene file: ", filename);
 		if (json == nullptr) { throw std::runtime_error("Failed to load scene from file: " + std::string(filename)); }
 
@@ -31,21 +47,25 @@ Scene::Scene(const std::string_view &filename) {
 
 		if(jo.find("meshes") != jo.end()) {
 			const auto &meshesJSON = jo["meshes"].as<JSONArray>();
+			trace::Zone zone("Load meshes", "meshes", meshesJSON.size());
 			for(const auto &j : meshesJSON) {
 				auto &obj = j->as<JSONObject>();
 				meshes.emplace_back(obj);
 			}
 		}
 
-		auto &objectsJSON = jo["objects"].as<JSONArray>();
-		for (const auto &j : objectsJSON) {
-			const auto &obj = j->as<JSONObject>();
-			if(obj.find("ref") == obj.end()) {
-				meshes.emplace_back(obj);
-				bvh.addPrimitive(new MeshObject(*this, meshes.size()-1, obj));
-			} else {
-				std::size_t meshIndex = obj["ref"].as<JSONNumber>();
-				bvh.addPrimitive(new MeshObject(*this, meshIndex, obj));
+		{
+			auto	   &objectsJSON = jo["objects"].as<JSONArray>();
+			trace::Zone zone("Load objects", "objects", objectsJSON.size());
+			for (const auto &j : objectsJSON) {
+				const auto &obj = j->as<JSONObject>();
+				if(obj.find("ref") == obj.end()) {
+					meshes.emplace_back(obj);
+					bvh.addPrimitive(new MeshObject(*this, meshes.size()-1, obj));
+				} else {
+					std::size_t meshIndex = obj["ref"].as<JSONNumber>();
+					bvh.addPrimitive(new MeshObject(*this, meshIndex, obj));
+				}
 			}
 		}
 
@@ -57,6 +77,7 @@ Scene::Scene(const std::string_view &filename) {
 		if (jo.find("textures") != jo.end()) {
 			auto &texturesJSON = jo["textures"].as<JSONArray>();
 			dbLog(dbg::LOG_DEBUG, "Found ", texturesJSON.size(), " textures in scene file.");
+			trace::Zone zone("Load textures", "textures", texturesJSON.size());
 			for (const auto &j : texturesJSON) {
 				auto &obj = j->as<JSONObject>();
 				if (obj["type"].as<JSONString>() == std::string_view("albedo")) {
@@ -66,7 +87,7 @@ Scene::Scene(const std::string_view &filename) {
 				} else if (obj["type"].as<JSONString>() == std::string_view("edges")) {
 					textures.emplace_back(new EdgeTexture(obj));
 				} else if (obj["type"].as<JSONString>() == std::string_view("bitmap")) {
-					textures.emplace_back(new ImageTexture(obj, this->scenePath));
+					textures.emplace_back(new ImageTexture(obj, this->scenePath, textureManager));
 				} else {
 					throw std::runtime_error("Unknown texture type: " + std::string(obj["type"].as<JSONString>()));
 				}
@@ -79,7 +100,8 @@ Scene::Scene(const std::string_view &filename) {
 		if (jo.find("materials") == jo.end()) {
 			dbLog(dbg::LOG_WARNING, "No materials found in scene file, using default materials.");
 		} else {
-			auto &materialsJSON = jo["materials"].as<JSONArray>();
+			auto	   &materialsJSON = jo["materials"].as<JSONArray>();
+			trace::Zone zone("Load materials", "materials", materialsJSON.size());
 			for (const auto &j : materialsJSON) {
 				auto &obj = j->as<JSONObject>();
 				if (obj["type"].as<JSONString>() == std::string_view("diffuse")) {
@@ -96,7 +118,12 @@ Scene::Scene(const std::string_view &filename) {
 			}
 		}
 
-		bvh.build();
+		textureManager.loadRequired();
+
+		{
+			trace::Zone zone("Top-level BVH");
+			bvh.build();
+		}
 		dbLog(dbg::LOG_DEBUG, "Scene loaded with ", getObjects().size(), " objects, ", lights.size(), " lights, and ",
 			  materials.size(), " materials.");
 	} catch (const std::exception &e) {
@@ -13,6 +13,7 @@
 #include <materials.hpp>
 #include "bvh.hpp"
 #include "mesh.hpp"
+#include "perf.hpp"
 
 class Scene {
    public:
@@ -35,8 +36,10 @@ class Scene {
 	std::vector<std::unique_ptr<Material>>	   materials;
 	std::vector<std::unique_ptr<Texture>>	   textures;
 	std::unordered_map<std::string, Texture *> textureMap;
+	TextureManager							   textureManager;
 
 	std::filesystem::path scenePath;
+	uint64_t			  fileHash = 0;	   ///< FNV-1a hash of the scene file, identifies the scene in checkpoints
 
 	std::vector<Mesh> meshes;
 
@@ -47,7 +50,14 @@ class Scene {
 
 	const auto &getObjects() const { return bvh.getObjects(); }
 
-	auto intersect(const Ray &r) const {
+	/// number of rays traced by the calling thread, used for throughput statistics
+	static inline thread_local std::uint64_t raysTraced = 0;
+
+	/// @param bounce - number of surfaces on the path before the ray, only used for the statistics
+	auto intersect(const Ray &r, unsigned bounce = 0) const {
+		perf::Scope scope(perf::Phase::Trace, true);
+		++raysTraced;
+		stats::countRay(r.type, bounce);
 		RayHit hit;
 		bvh.intersect(r, 0.0001f, FLT_MAX, hit);
 		return hit;
@@ -63,7 +73,7 @@ class Scene {
 	Scene &operator=(const Scene &) = delete;
 	Scene &operator=(Scene &&)		= delete;
 
-	Scene(const std::string_view &filename);
+	Scene(const std::string_view &filename, const TextureManager::Settings &textureSettings = {});
 
 	void clear() {
 		bvh.clear();
@@ -93,7 +103,7 @@ class Scene {
 
 	Texture *getTexture(const std::string_view &name) const {
 		auto it = textureMap.find(std::string(name));	  // TODO: use std::string_view for better performance
-		if (it != textureMap.end()) { return it->second; }
+		if (it != textureMap.end()) return it->second;
 		throw std::runtime_error(std::string("Texture not found: ") + std::string(name));
 	}
 
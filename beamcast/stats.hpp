@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <data.hpp>
+#include <img/image.hpp>
+#include <log.hpp>
+
+/*
+ * Traversal and ray statistics, compiled in with BEAMCAST_STATS (the TRAVERSAL_STATS CMake option). Every thread
+ * counts into its own Counters, the renderer adds those of a tile to its totals when the tile is done. Without
+ * BEAMCAST_STATS all counting functions are empty and inline to nothing.
+ */
+namespace stats {
+#ifdef BEAMCAST_STATS
+inline constexpr bool ENABLED = true;
+#else
+inline constexpr bool ENABLED = false;
+#endif
+
+/// rays are counted per bounce up to this one, deeper rays are added to it
+inline constexpr std::size_t MAX_BOUNCE = 8;
+
+/// The part of the counters that is summed per pixel for the heatmaps
+struct Cost {
+	uint64_t nodesVisited	  = 0;	   ///< BVH nodes entered, of the scene and of all meshes
+	uint64_t boxesTested	  = 0;	   ///< ray-box tests, including the root box of every tree
+	uint64_t primitivesTested = 0;	   ///< instances and triangles tested, after the filter
+	uint64_t rays			  = 0;
+
+	inline Cost &operator+=(const Cost &other) {
+		nodesVisited += other.nodesVisited;
+		boxesTested += other.boxesTested;
+		primitivesTested += other.primitivesTested;
+		rays += other.rays;
+		return *this;
+	}
+
+	/// @brief The counts since \a before as floats, computed in integers so that large totals keep their precision
+	inline RGBA32F since(const Cost &before) const {
+		return RGBA32F(float(nodesVisited - before.nodesVisited), float(boxesTested - before.boxesTested),
+					   float(primitivesTested - before.primitivesTested), float(rays - before.rays));
+	}
+};
+
+struct Counters {
+	Cost	 cost;
+	uint32_t stackDepth	   = 0;	   ///< nested BVH nodes currently being traversed
+	uint32_t maxStackDepth = 0;
+	/// rays by Ray::Type and bounce, the first bounce of primary rays are the camera rays
+	std::array<std::array<uint64_t, MAX_BOUNCE + 1>, 2> raysByType{};
+
+	inline Counters &operator+=(const Counters &other) {
+		cost += other.cost;
+		maxStackDepth = std::max(maxStackDepth, other.maxStackDepth);
+		for (std::size_t type = 0; type < raysByType.size(); ++type) {
+			for (std::size_t bounce = 0; bounce <= MAX_BOUNCE; ++bounce) {
+				raysByType[type][bounce] += other.raysByType[type][bounce];
+			}
+		}
+		return *this;
+	}
+
+	void log() const {
+		const float rays = std::max<float>(cost.rays, 1.f);
+		dbLog(dbg::LOG_INFO, "Traversal statistics for ", cost.rays, " rays: ", cost.nodesVisited / rays,
+			  " nodes visited, ", cost.boxesTested / rays, " boxes and ", cost.primitivesTested / rays,
+			  " primitives tested per ray, stack depth up to ", maxStackDepth);
+		for (std::size_t type = 0; type < raysByType.size(); ++type) {
+			std::string counts;
+			for (std::size_t bounce = 0; bounce <= MAX_BOUNCE; ++bounce) {
+				counts += (bounce ? ", " : "") + std::to_string(raysByType[type][bounce]);
+			}
+			// the last count includes the deeper bounces
+			dbLog(dbg::LOG_INFO, type == Ray::Primary ? "  primary" : "  shadow", " rays per bounce: ", counts, "+");
+		}
+	}
+};
+
+/// @brief The counters of the calling thread
+inline Counters &local() {
+	static thread_local Counters counters;
+	return counters;
+}
+
+inline void countRay(Ray::Type type, unsigned bounce) {
+	if constexpr (ENABLED) {
+		auto &counters = local();
+		++counters.cost.rays;
+		++counters.raysByType[type][std::min<std::size_t>(bounce, MAX_BOUNCE)];
+	}
+}
+
+inline void countBoxes(uint64_t count) {
+	if constexpr (ENABLED) local().cost.boxesTested += count;
+}
+
+inline void countPrimitive() {
+	if constexpr (ENABLED) ++local().cost.primitivesTested;
+}
+
+/// Measures the cost counted by the calling thread during its lifetime, always zero without BEAMCAST_STATS
+class CostMeter {
+	Cost start;
+
+   public:
+	inline CostMeter() {
+		if constexpr (ENABLED) start = local().cost;
+	}
+
+	inline RGBA32F elapsed() const {
+		if constexpr (ENABLED) return local().cost.since(start);
+		else return RGBA32F(0.f);
+	}
+};
+
+/// Counts a visited BVH node and keeps track of the traversal stack depth while it lives
+struct NodeVisit {
+	inline NodeVisit() {
+		if constexpr (ENABLED) {
+			auto &counters = local();
+			++counters.cost.nodesVisited;
+			counters.maxStackDepth = std::max(counters.maxStackDepth, ++counters.stackDepth);
+		}
+	}
+	inline ~NodeVisit() {
+		if constexpr (ENABLED) --local().stackDepth;
+	}
+	NodeVisit(const NodeVisit &)			= delete;
+	NodeVisit &operator=(const NodeVisit &) = delete;
+};
+}	  // namespace stats
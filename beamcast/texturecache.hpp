@@ -0,0 +1,405 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <img/mipmap.hpp>
+#include <log.hpp>
+
+/*
+ * Tiled texture files, MipMaps converted for paging. After a header come the pages of all levels, each PAGE_SIZE x
+ * PAGE_SIZE texels of 8 bit RGBA (PAGE_BYTES bytes) and row major within a level. Inside a page the texels are in
+ * 8x8 tiles like in a MipMap. The header records the size and time of the image file the texture was converted
+ * from, so a changed image is converted again.
+ */
+namespace tiledfile {
+inline constexpr std::size_t PAGE_SIZE	 = 32;
+inline constexpr std::size_t PAGE_TEXELS = PAGE_SIZE * PAGE_SIZE;
+inline constexpr std::size_t PAGE_BYTES	 = PAGE_TEXELS * sizeof(RGBA);
+inline constexpr uint32_t	 VERSION	 = 2;	  ///< changed whenever the texels of a converted image change
+inline constexpr std::size_t MAX_LEVELS	 = 32;
+
+struct Level {
+	uint32_t width;
+	uint32_t height;
+	uint64_t firstPage;
+};
+
+struct Header {
+	std::array<char, 4>				  magic = {'B', 'C', 'T', 'X'};
+	uint32_t						  version;
+	uint32_t						  colorSpace;
+	uint32_t						  levelCount;
+	uint64_t						  sourceSize;
+	int64_t							  sourceTime;
+	std::array<Level, MAX_LEVELS> levels;
+};
+static_assert(sizeof(Header) <= PAGE_BYTES, "the pages start after the first PAGE_BYTES bytes");
+
+inline std::size_t pagesX(std::size_t width) { return (width + PAGE_SIZE - 1) / PAGE_SIZE; }
+
+/// @brief Index of texel (x, y) in its page
+inline uint32_t inPage(uint32_t x, uint32_t y) {
+	x %= PAGE_SIZE;
+	y %= PAGE_SIZE;
+	return ((y / 8) * (PAGE_SIZE / 8) + x / 8) * 64 + (y % 8) * 8 + x % 8;
+}
+
+/// @brief Header with the size and time of \a source, for comparing with the header of a file
+inline Header stamp(const std::filesystem::path &source, ColorSpace colorSpace) {
+	Header header{};
+	header.magic	  = {'B', 'C', 'T', 'X'};
+	header.version	  = VERSION;
+	header.colorSpace = uint32_t(colorSpace);
+	header.sourceSize = std::filesystem::file_size(source);
+	header.sourceTime = std::filesystem::last_write_time(source).time_since_epoch().count();
+	return header;
+}
+
+/// @brief Checks that \a file is a tiled texture converted from the current version of the \a expected source
+inline bool isCurrent(const std::filesystem::path &file, const Header &expected) {
+	std::ifstream in(file, std::ios::binary);
+	Header		  header;
+	if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+	return header.magic == expected.magic && header.version == VERSION && header.colorSpace == expected.colorSpace &&
+		   header.sourceSize == expected.sourceSize && header.sourceTime == expected.sourceTime;
+}
+
+/// @brief Writes \a mipmap to \a file with the \a header of its source. The file is written under a temporary name
+/// and renamed, so other processes never see half of it.
+inline void write(const MipMap &mipmap, const std::filesystem::path &file, Header header) {
+	if (mipmap.levelCount() > MAX_LEVELS) throw std::runtime_error("Texture has too many mip levels: " + file.string());
+	header.levelCount = mipmap.levelCount();
+	uint64_t pages	  = 0;
+	for (std::size_t l = 0; l < mipmap.levelCount(); ++l) {
+		const auto w	  = mipmap.levelWidth(l), h = mipmap.levelHeight(l);
+		header.levels[l] = Level{uint32_t(w), uint32_t(h), pages};
+		pages += pagesX(w) * pagesX(h);
+	}
+
+	auto temporary = file;
+	temporary += ".tmp" + std::to_string(getpid());
+	{
+		std::ofstream out(temporary, std::ios::binary);
+		std::vector<char> first(PAGE_BYTES, 0);
+		std::memcpy(first.data(), &header, sizeof(header));
+		out.write(first.data(), first.size());
+
+		std::array<RGBA, PAGE_TEXELS> page;
+		for (std::size_t l = 0; l < mipmap.levelCount(); ++l) {
+			const auto w = mipmap.levelWidth(l), h = mipmap.levelHeight(l);
+			for (std::size_t py = 0; py < pagesX(h); ++py) {
+				for (std::size_t px = 0; px < pagesX(w); ++px) {
+					page.fill(RGBA{0, 0, 0, 0});
+					for (std::size_t y = py * PAGE_SIZE; y < std::min((py + 1) * PAGE_SIZE, h); ++y) {
+						for (std::size_t x = px * PAGE_SIZE; x < std::min((px + 1) * PAGE_SIZE, w); ++x) {
+							page[inPage(x, y)] = mipmap.texel(l, x, y);
+						}
+					}
+					out.write(reinterpret_cast<const char *>(page.data()), PAGE_BYTES);
+				}
+			}
+		}
+		if (!out) throw std::runtime_error("Failed to write tiled texture: " + temporary.string());
+	}
+	std::filesystem::rename(temporary, file);
+}
+}	  // namespace tiledfile
+
+/**
+ * Keeps the recently used pages of tiled texture files in a fixed memory budget, for textures that do not fit in
+ * memory. A page missing from the cache is read with pread() into the slot picked by a CLOCK sweep, which skips the
+ * slots sampled since it last passed them.
+ *
+ * Lookups from render threads take no lock. Every file has a table with the slot of each of its pages and every slot
+ * a version that is odd while the slot is being refilled. A lookup reads the slot from the table, the texel from the
+ * slot and checks that the slot was neither refilled nor given to another page in between, like a seqlock. Only misses
+ * take the lock, to pick the slot, the read itself happens without it.
+ */
+class TextureCache {
+   public:
+	struct Statistics {
+		uint64_t hits	   = 0;
+		uint64_t misses	   = 0;	   ///< pages read from disk
+		uint64_t evictions = 0;
+	};
+
+	/// A tiled texture file whose pages are read through the cache, a texfilter TexelSource
+	class File {
+		TextureCache			 &cache;
+		std::filesystem::path	  path;
+		int						  fd = -1;
+		uint32_t				  id = 0;
+		tiledfile::Header		  header;
+		std::vector<std::size_t> levelPagesX;
+		float					  bias;
+		/// slot + 1 of every page, 0 when it is not cached, LOADING while it is read
+		std::unique_ptr<std::atomic_uint32_t[]> pages;
+
+		friend class TextureCache;
+
+	   public:
+		File(TextureCache &cache, const std::filesystem::path &path) : cache(cache), path(path) {
+			fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) throw std::runtime_error("Failed to open tiled texture " + path.string() + ": " + std::strerror(errno));
+			if (pread(fd, &header, sizeof(header), 0) != ssize_t(sizeof(header)) || header.levelCount == 0 ||
+				header.levelCount > tiledfile::MAX_LEVELS) {
+				::close(fd);
+				throw std::runtime_error("Invalid tiled texture: " + path.string());
+			}
+			uint64_t pageCount = 0;
+			for (std::size_t l = 0; l < header.levelCount; ++l) {
+				const auto &level = header.levels[l];
+				levelPagesX.push_back(tiledfile::pagesX(level.width));
+				pageCount = level.firstPage + levelPagesX.back() * tiledfile::pagesX(level.height);
+			}
+			bias  = 0.5f * std::log2(float(header.levels[0].width) * float(header.levels[0].height));
+			pages = std::make_unique<std::atomic_uint32_t[]>(pageCount);
+			id	  = cache.attach(this);
+		}
+
+		File(const File &)			  = delete;
+		File &operator=(const File &) = delete;
+
+		~File() {
+			cache.detach(id);
+			::close(fd);
+		}
+
+		inline std::size_t levelCount() const { return header.levelCount; }
+		inline std::size_t levelWidth(std::size_t l) const { return header.levels[l].width; }
+		inline std::size_t levelHeight(std::size_t l) const { return header.levels[l].height; }
+		inline ColorSpace getColorSpace() const { return ColorSpace(header.colorSpace); }
+		inline float lodBias() const { return bias; }
+
+		inline RGBA texel(std::size_t l, int x, int y) const {
+			const uint32_t page = header.levels[l].firstPage + (y / tiledfile::PAGE_SIZE) * levelPagesX[l] +
+								  x / tiledfile::PAGE_SIZE;
+			return cache.fetch(*this, page, tiledfile::inPage(x, y));
+		}
+
+		__m128 sampleSSE(vec2 uv, float footprint, TextureFilter filter) const {
+			return texfilter::sample(*this, uv, footprint, filter);
+		}
+	};
+
+   private:
+	static constexpr uint32_t	 LOADING   = ~0u;
+	static constexpr uint64_t	 EMPTY	   = ~0ull;
+	static constexpr std::size_t MIN_SLOTS = 64;
+
+	struct alignas(64) Page {
+		std::array<uint32_t, tiledfile::PAGE_TEXELS> texels;
+	};
+
+	struct Slot {
+		std::atomic_uint32_t version	= 0;	 ///< odd while the page is read
+		std::atomic_uint64_t owner		= EMPTY;	 ///< file id << 32 | page
+		std::atomic_bool	 referenced = false;
+	};
+
+	/// counters of one thread, only written by it and on their own cache line
+	struct alignas(64) Counters {
+		std::atomic_uint64_t hits	= 0;
+		std::atomic_uint64_t misses = 0;
+	};
+
+	std::size_t				slotCount;
+	std::unique_ptr<Page[]> data;	  ///< not initialized, the budget is only touched as pages are read
+	std::unique_ptr<Slot[]> slots;
+
+	std::mutex			mutex;
+	std::vector<File *> files;		 ///< by id, nullptr once closed, guarded by mutex
+	std::size_t			hand = 0;	 ///< of the CLOCK, guarded by mutex
+	uint64_t			evictions = 0;	  ///< guarded by mutex
+	std::atomic_bool	readFailed = false;
+
+	Statistics start;	 ///< of the counters of all threads when the cache was made
+	Statistics logged;	 ///< statistics() at the last logStatistics()
+
+	struct Registry {
+		std::mutex							   mutex;
+		std::vector<std::shared_ptr<Counters>> counters;	 ///< kept after their thread exits
+	};
+
+	static Registry &registry() {
+		static Registry r;
+		return r;
+	}
+
+	static Counters &local() {
+		static thread_local std::shared_ptr<Counters> counters = [] {
+			auto			c = std::make_shared<Counters>();
+			auto		   &r = registry();
+			std::lock_guard lock(r.mutex);
+			r.counters.push_back(c);
+			return c;
+		}();
+		return *counters;
+	}
+
+	/// @brief Sums the counters of all threads since the start of the program
+	static Statistics sum() {
+		Statistics		s;
+		auto		   &r = registry();
+		std::lock_guard lock(r.mutex);
+		for (const auto &c : r.counters) {
+			s.hits += c->hits.load(std::memory_order_relaxed);
+			s.misses += c->misses.load(std::memory_order_relaxed);
+		}
+		return s;
+	}
+
+	static inline void increment(std::atomic_uint64_t &counter) {
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	uint32_t attach(File *file) {
+		std::lock_guard lock(mutex);
+		files.push_back(file);
+		return files.size() - 1;
+	}
+
+	void detach(uint32_t id) {
+		std::lock_guard lock(mutex);
+		files[id] = nullptr;
+	}
+
+	/// @brief The next slot of the CLOCK sweep that was not used since the last sweep, guarded by mutex
+	std::size_t victim() {
+		while (true) {
+			const std::size_t index = hand;
+			hand					= (hand + 1) % slotCount;
+			Slot &slot				= slots[index];
+			if (slot.version.load(std::memory_order_relaxed) & 1) continue;
+			if (slot.referenced.exchange(false, std::memory_order_relaxed)) continue;
+			return index;
+		}
+	}
+
+	/// @brief Reads \a page of \a file into a slot unless another thread already does
+	/// @return false if another thread did
+	bool load(const File &file, uint32_t page) {
+		std::size_t index;
+		uint32_t	version;
+		{
+			std::lock_guard lock(mutex);
+			if (file.pages[page].load(std::memory_order_relaxed) != 0) return false;
+			index			  = victim();
+			Slot	 &slot	  = slots[index];
+			const uint64_t previous = slot.owner.load(std::memory_order_relaxed);
+			if (previous != EMPTY) {
+				if (File *owner = files[previous >> 32]) owner->pages[uint32_t(previous)].store(0, std::memory_order_relaxed);
+				++evictions;
+			}
+			version = slot.version.load(std::memory_order_relaxed) + 1;
+			slot.version.store(version, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.owner.store(uint64_t(file.id) << 32 | page, std::memory_order_relaxed);
+			file.pages[page].store(LOADING, std::memory_order_relaxed);
+		}
+		increment(local().misses);
+
+		static thread_local Page buffer;
+		const off_t				 offset = off_t(tiledfile::PAGE_BYTES) * (1 + page);
+		if (pread(file.fd, buffer.texels.data(), tiledfile::PAGE_BYTES, offset) != ssize_t(tiledfile::PAGE_BYTES)) {
+			if (!readFailed.exchange(true)) {
+				dbLog(dbg::LOG_ERROR, "Failed to read a page of ", file.path, ", missing pages are magenta");
+			}
+			buffer.texels.fill(0xffff00ffu);
+		}
+		// readers that still use the slot for its previous page see the odd version and retry
+		for (std::size_t i = 0; i < tiledfile::PAGE_TEXELS; ++i) {
+			std::atomic_ref(data[index].texels[i]).store(buffer.texels[i], std::memory_order_relaxed);
+		}
+		// published after the texels, and before the version is even so the sweep never takes a slot the table misses.
+		// A reader that sees the entry also sees the texels and at least the odd version.
+		file.pages[page].store(index + 1, std::memory_order_release);
+		slots[index].referenced.store(true, std::memory_order_relaxed);
+		slots[index].version.store(version + 1, std::memory_order_release);
+		return true;
+	}
+
+	RGBA fetch(const File &file, uint32_t page, uint32_t texel) {
+		const uint64_t owner  = uint64_t(file.id) << 32 | page;
+		bool		   missed = false;
+		while (true) {
+			const uint32_t entry = file.pages[page].load(std::memory_order_acquire);
+			if (entry == 0) {
+				missed |= load(file, page);
+				continue;
+			}
+			if (entry == LOADING) {
+				std::this_thread::yield();
+				continue;
+			}
+			Slot		  &slot	   = slots[entry - 1];
+			const uint32_t version = slot.version.load(std::memory_order_acquire);
+			if ((version & 1) || slot.owner.load(std::memory_order_relaxed) != owner) continue;
+			const uint32_t bits = std::atomic_ref(data[entry - 1].texels[texel]).load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.version.load(std::memory_order_relaxed) != version) continue;
+
+			if (!slot.referenced.load(std::memory_order_relaxed)) slot.referenced.store(true, std::memory_order_relaxed);
+			if (!missed) increment(local().hits);
+			return std::bit_cast<RGBA>(bits);
+		}
+	}
+
+   public:
+	/// @param budget - bytes of texels to keep in memory, at least MIN_SLOTS pages are kept
+	explicit TextureCache(std::size_t budget)
+		: slotCount(std::max(budget / tiledfile::PAGE_BYTES, MIN_SLOTS)),
+		  data(new Page[slotCount]),
+		  slots(std::make_unique<Slot[]>(slotCount)),
+		  start(sum()) {}
+
+	TextureCache(const TextureCache &)			  = delete;
+	TextureCache &operator=(const TextureCache &) = delete;
+
+	inline std::size_t budget() const { return slotCount * tiledfile::PAGE_BYTES; }
+
+	/// @brief Hits and misses of all threads since the cache was made
+	Statistics statistics() {
+		Statistics s = sum();
+		s.hits -= start.hits;
+		s.misses -= start.misses;
+		std::lock_guard lock(mutex);
+		s.evictions = evictions;
+		return s;
+	}
+
+	/// @brief Bytes of the slots that hold a page
+	std::size_t resident() {
+		std::size_t pages = 0;
+		for (std::size_t i = 0; i < slotCount; ++i) pages += slots[i].owner.load(std::memory_order_relaxed) != EMPTY;
+		return pages * tiledfile::PAGE_BYTES;
+	}
+
+	/// @brief Logs the hits, misses and evictions since the last call, like those of a frame
+	void logStatistics() {
+		const Statistics now = statistics();
+		const Statistics s{now.hits - logged.hits, now.misses - logged.misses, now.evictions - logged.evictions};
+		logged				 = now;
+		const uint64_t total = s.hits + s.misses;
+		if (total == 0) return;
+		dbLog(dbg::LOG_INFO, "Texture cache: ", s.hits, " hits, ", s.misses, " misses (", 100.f * s.hits / total,
+			  "% hits), ", s.evictions, " evictions, ", resident() / 1e6f, " of ", budget() / 1e6f, " MB used");
+	}
+};
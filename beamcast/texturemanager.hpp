@@ -0,0 +1,224 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <hash.hpp>
+#include <img/image.hpp>
+#include <img/mipmap.hpp>
+#include <log.hpp>
+#include <texturecache.hpp>
+#include <threading.hpp>
+#include <trace.hpp>
+
+/**
+ * Owns the decoded images of the ImageTextures of a scene. Textures only register their file when the scene is
+ * parsed, files used by several textures are decoded once. Materials mark the textures they use with
+ * Texture::require(), loadRequired() then decodes those in parallel and skips the rest. With Settings::lazy nothing
+ * is decoded up front, every image is decoded by the first thread that samples it.
+ *
+ * With a Settings::cacheBytes budget images are not kept in memory. Each is converted once to a tiled file in
+ * Settings::cacheFolder, which is converted again when the image changes, and its pages are read through a
+ * TextureCache of that size. Images whose tiled file is current are not decoded at all, and at most MAX_CONVERSIONS
+ * images are decoded for conversion at once, so the budget is not exceeded by decoded images.
+ */
+class TextureManager {
+   public:
+	/// images decoded at once to convert them to tiled files
+	static constexpr std::ptrdiff_t MAX_CONVERSIONS = 2;
+	using Conversions								= std::counting_semaphore<MAX_CONVERSIONS>;
+
+	struct Settings {
+		bool		lazy	   = false;								  ///< decode images when they are first sampled
+		uint		threads	   = std::thread::hardware_concurrency();	  ///< decoding images at once
+		std::size_t cacheBytes = 0;	   ///< budget of the TextureCache, 0 keeps all images in memory
+		/// where the tiled files of a TextureCache are kept
+		std::filesystem::path cacheFolder = std::filesystem::temp_directory_path() / "beamcast-textures";
+	};
+
+	/// An image file and its mip levels once they are decoded, in memory or in a tiled file paged by the cache
+	class Entry {
+		std::filesystem::path path;
+		ColorSpace			  colorSpace;
+
+		std::shared_ptr<TextureCache> cache;	  ///< kept alive for the tiled file
+		std::filesystem::path		  tiledPath;
+		std::shared_ptr<Conversions>  conversions;	   ///< shared by the entries of a manager
+
+		std::atomic_bool					ready = false;	   ///< set once the image is decoded
+		std::unique_ptr<MipMap>				mipmap;			   ///< without a cache or if decoding failed
+		std::unique_ptr<TextureCache::File> tiled;
+		std::once_flag						once;
+		std::string							error;	   ///< why decoding failed, set before ready
+		std::atomic_bool					required = false;
+
+		friend class TextureManager;
+
+		void decode() {
+			if (!cache) {
+				Image<RGBA> file;
+				file.loadFromFile(path);
+				mipmap = std::make_unique<MipMap>(file, colorSpace);
+				return;
+			}
+			const auto stamp = tiledfile::stamp(path, colorSpace);
+			if (!tiledfile::isCurrent(tiledPath, stamp)) {
+				conversions->acquire();
+				try {
+					Image<RGBA> file;
+					file.loadFromFile(path);
+					tiledfile::write(MipMap(file, colorSpace), tiledPath, stamp);
+				} catch (...) {
+					conversions->release();
+					throw;
+				}
+				conversions->release();
+				dbLog(dbg::LOG_DEBUG, "Converted ", path, " to ", tiledPath);
+			}
+			tiled = std::make_unique<TextureCache::File>(*cache, tiledPath);
+		}
+
+		void load() {
+			std::call_once(once, [this] {
+				trace::Zone zone("Decode texture");
+				try {
+					decode();
+				} catch (const std::exception &e) {
+					// a missing texture is magenta, loadRequired() still fails the scene load
+					error = e.what();
+					dbLog(dbg::LOG_ERROR, "Texture ", path, " could not be decoded: ", error);
+					Image<RGBA> missing(1, 1);
+					missing[0] = RGBA{255, 0, 255, 255};
+					tiled.reset();
+					mipmap = std::make_unique<MipMap>(missing);
+				}
+				ready.store(true, std::memory_order_release);
+			});
+		}
+
+	   public:
+		Entry(std::filesystem::path path, ColorSpace colorSpace) : path(std::move(path)), colorSpace(colorSpace) {}
+
+		/// @brief Entry converted to \a tiledPath and paged through \a cache
+		Entry(std::filesystem::path path, ColorSpace colorSpace, std::shared_ptr<TextureCache> cache,
+			  std::filesystem::path tiledPath, std::shared_ptr<Conversions> conversions)
+			: path(std::move(path)),
+			  colorSpace(colorSpace),
+			  cache(std::move(cache)),
+			  tiledPath(std::move(tiledPath)),
+			  conversions(std::move(conversions)) {}
+
+		/// @brief Filtered color at \a uv, see MipMap::sampleSSE(). The image is decoded by the calling thread if no
+		/// thread did so yet.
+		inline __m128 sampleSSE(vec2 uv, float footprint, TextureFilter filter) {
+			if (!ready.load(std::memory_order_acquire)) load();
+			return tiled ? tiled->sampleSSE(uv, footprint, filter) : mipmap->sampleSSE(uv, footprint, filter);
+		}
+
+		inline RGBA32F sample(vec2 uv, float footprint, TextureFilter filter) {
+			RGBA32F result;
+			_mm_storeu_ps(result.data, sampleSSE(uv, footprint, filter));
+			return result;
+		}
+
+		inline void require() { required.store(true, std::memory_order_relaxed); }
+		inline bool isDecoded() const { return ready.load(std::memory_order_acquire); }
+		inline const std::filesystem::path &getPath() const { return path; }
+	};
+
+   private:
+	Settings					  settings;
+	std::shared_ptr<TextureCache> cache;	 ///< only with a Settings::cacheBytes budget
+	std::shared_ptr<Conversions>  conversions = std::make_shared<Conversions>(MAX_CONVERSIONS);
+	/// by resolved path and color space
+	std::map<std::pair<std::string, ColorSpace>, std::shared_ptr<Entry>> entries;
+	std::mutex															 mutex;
+
+   public:
+	TextureManager() = default;
+	explicit TextureManager(const Settings &settings) : settings(settings) {
+		if (settings.cacheBytes == 0) return;
+		std::filesystem::create_directories(settings.cacheFolder);
+		cache = std::make_shared<TextureCache>(settings.cacheBytes);
+	}
+
+	inline const Settings &getSettings() const { return settings; }
+	/// @brief The cache the images are paged through, nullptr without a Settings::cacheBytes budget
+	inline TextureCache *getCache() const { return cache.get(); }
+
+	/// @brief The entry of \a path, relative paths are relative to the folder of \a scenePath. Nothing is decoded.
+	std::shared_ptr<Entry> acquire(const std::filesystem::path &path, const std::filesystem::path &scenePath,
+								   ColorSpace colorSpace) {
+		auto folder = scenePath.parent_path();
+		if (folder.empty()) folder = std::filesystem::current_path();
+		const auto resolved = std::filesystem::weakly_canonical(path.is_relative() ? folder / path : path);
+
+		std::lock_guard lock(mutex);
+		auto		   &entry = entries[{resolved.string(), colorSpace}];
+		if (entry) return entry;
+		if (!cache) {
+			entry = std::make_shared<Entry>(resolved, colorSpace);
+			return entry;
+		}
+		// named by the image and a hash of its path, so images with the same name in other folders do not collide,
+		// and the same file is found again by other builds
+		std::ostringstream name;
+		name << resolved.stem().string() << '-' << std::hex
+			 << fnv1a::hash(resolved.string() + char('0' + int(colorSpace))) << ".btx";
+		entry = std::make_shared<Entry>(resolved, colorSpace, cache, settings.cacheFolder / name.str(), conversions);
+		return entry;
+	}
+
+	/// @brief Decodes the required images on Settings::threads threads, unless images are decoded lazily. With a
+	/// cache only MAX_CONVERSIONS of them convert images at once.
+	/// @throws std::runtime_error if an image could not be decoded
+	void loadRequired() {
+		std::vector<Entry *> pending;
+		std::size_t			 unused = 0;
+		{
+			std::lock_guard lock(mutex);
+			for (const auto &[key, entry] : entries) {
+				if (!entry->required.load(std::memory_order_relaxed)) ++unused;
+				else if (!entry->isDecoded()) pending.push_back(entry.get());
+			}
+		}
+		if (unused) dbLog(dbg::LOG_INFO, "Skipping ", unused, " images no material uses");
+		if (settings.lazy || pending.empty()) return;
+
+		trace::Zone zone("Decode textures", "images", pending.size());
+		{
+			OneShotThreadPool pool(std::max(1u, std::min<uint>(settings.threads, pending.size())));
+			for (Entry *entry : pending) {
+				pool.addJob(entry, [](const std::any &job) { std::any_cast<Entry *>(job)->load(); });
+			}
+			pool.start();
+			pool.wait();
+		}
+		for (const Entry *entry : pending) {
+			if (!entry->error.empty()) throw std::runtime_error("Failed to load texture: " + entry->error);
+		}
+		if (cache) {
+			dbLog(dbg::LOG_INFO, "Decoded ", pending.size(), " images into ", settings.cacheFolder, ", paged through a ",
+				  cache->budget() / 1e6f, " MB cache");
+		} else dbLog(dbg::LOG_INFO, "Decoded ", pending.size(), " images, ", memory() / 1e6f, " MB");
+	}
+
+	/// @brief Bytes held by the decoded images in memory, without the cache
+	std::size_t memory() {
+		std::lock_guard lock(mutex);
+		std::size_t		bytes = 0;
+		for (const auto &[key, entry] : entries) {
+			if (entry->isDecoded() && entry->mipmap) bytes += entry->mipmap->memory();
+		}
+		return bytes;
+	}
+};
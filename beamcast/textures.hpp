@@ -3,12 +3,17 @@
 #include <data.hpp>
 #include <filesystem>
 #include <img/image.hpp>
+#include <img/mipmap.hpp>
+#include <texturemanager.hpp>
 
 class Texture {
    public:
 	virtual ~Texture() = default;
 
 	virtual vec3 sample(const RayHit &hit) const = 0;
+
+	/// @brief Called for the textures materials use, before anything is sampled
+	virtual void require() {}
 };
 
 class ConstantTexure : public Texture {
@@ -74,21 +79,27 @@ class EdgeTexture : public Texture {
 	}
 };
 
+/// An image file with mip levels, decoded by the TextureManager. Sampled with the texture coordinate footprint of the
+/// hit, see RayHit::uvFootprint, and the "filter" of the texture: "nearest", "bilinear" or "trilinear" (the default).
+/// The "color_space" of the file is "linear" (the default, the 8 bit values divided by 255) or "srgb".
 class ImageTexture : public Texture {
    public:
-	Image<RGB32F> image;
-
-	ImageTexture(const JSONObject &obj, const std::filesystem::path &scenePath) {
-		const auto &filename	= obj["file_path"].as<JSONString>();
-		auto		sceneFolder = scenePath.parent_path();
-		if (sceneFolder.empty()) { sceneFolder = std::filesystem::current_path(); }
-		auto fullPath = std::filesystem::path(std::string_view(filename));
-		if (fullPath.is_relative()) fullPath = sceneFolder.concat(fullPath.string());
-
-		image.loadFromFile(fullPath);
+	std::shared_ptr<TextureManager::Entry> image;
+	TextureFilter						   filter = TextureFilter::Trilinear;
+
+	ImageTexture(const JSONObject &obj, const std::filesystem::path &scenePath, TextureManager &manager) {
+		const auto &filename = obj["file_path"].as<JSONString>();
+		if (obj.find("filter") != obj.end()) filter = textureFilterFromString(obj["filter"].as<JSONString>());
+		ColorSpace colorSpace = ColorSpace::Linear;
+		if (obj.find("color_space") != obj.end()) {
+			colorSpace = colorSpaceFromString(obj["color_space"].as<JSONString>());
+		}
+		image = manager.acquire(std::filesystem::path(std::string_view(filename)), scenePath, colorSpace);
 	}
 
+	void require() override { image->require(); }
+
 	vec3 sample(const RayHit &hit) const override {
-		return image.sample(hit.texCoords.xy());
+		return image->sample(hit.texCoords.xy(), hit.uvFootprint, filter).xyz();
 	}
 };
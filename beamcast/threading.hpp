@@ -4,10 +4,15 @@
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include <log.hpp>
+#include <trace.hpp>
+
 /**
  * Thread pool made for maximum performance and minimum flexibility.
  * Jobs will be added once, then all threads will wait to finish and then the job queue will be cleared.
@@ -28,8 +33,10 @@ class OneShotThreadPool {
 	uint					 num_threads;
 	std::condition_variable	 start_cv;
 	std::mutex				 start_mtx;
-	volatile bool			 running  = true;
-	volatile bool			 has_work = false;
+	bool					 running  = true;		///< guarded by start_mtx
+	bool					 has_work = false;		///< guarded by start_mtx
+	uint					 generation = 0;		///< incremented by every start(), guarded by start_mtx
+	uint					 active	  = 0;			///< workers taking jobs, guarded by done_mtx
 
 	std::condition_variable done_cv;
 	std::mutex				done_mtx;
@@ -38,38 +45,50 @@ class OneShotThreadPool {
 	OneShotThreadPool(uint num_threads = std::thread::hardware_concurrency()) : num_threads(num_threads) {
 		threads.reserve(num_threads);
 
-		auto worker = [this]() {
-			while (running) {
-				if (!has_work) {
+		auto worker = [this](uint index) {
+			trace::setThreadName("Worker " + std::to_string(index));
+			uint seen = 0;
+			while (true) {
+				{
 					std::unique_lock lock(start_mtx);
-					start_cv.wait_for(lock, std::chrono::milliseconds(100), [this]() { return !running || has_work; });
+					trace::Zone		 idle("Idle");
+					// a worker joins every batch at most once, a late one sees has_work cleared by wait()
+					start_cv.wait(lock, [&]() { return !running || (has_work && generation != seen); });
+					if (!running) return;
+					seen = generation;
+					// counted while start_mtx is held, so wait() cannot miss a worker that is about to take jobs
+					std::lock_guard active_lock(done_mtx);
+					++active;
 				}
-				if (!running) return;
-				uint_fast32_t job_index = jobs_taken.fetch_add(1, std::memory_order_seq_cst);
-				if (job_index >= job_queue.size()) {
-					has_work = false;
-					continue;
+
+				const std::size_t job_count = job_queue.size();
+				while (true) {
+					uint_fast32_t job_index = jobs_taken.fetch_add(1, std::memory_order_seq_cst);
+					if (job_index >= job_count) break;
+
+					auto &[j, f] = job_queue[job_index];
+					f(j);
+					jobs_done.fetch_add(1, std::memory_order_seq_cst);
 				}
 
-				auto &[j, f] = job_queue[job_index];
-				f(j);
-				auto done_counter = jobs_done.fetch_add(1, std::memory_order_seq_cst);
-				if (done_counter + 1 == job_queue.size()) { done_cv.notify_all(); }
+				{
+					std::lock_guard lock(done_mtx);
+					--active;
+				}
+				done_cv.notify_all();
 			}
 		};
 
 		for (uint i = 0; i < num_threads; ++i) {
-			threads.emplace_back(worker);
+			threads.emplace_back(worker, i);
 		}
 	}
 
 	~OneShotThreadPool() { stop(); }
 
 	void reset() {
-		running = true;
-		has_work = false;
 		jobs_taken = 0;
-		jobs_done = 0;
+		jobs_done  = 0;
 		job_queue.clear();
 	}
 
@@ -79,15 +98,31 @@ class OneShotThreadPool {
 
 	void start() {
 		if (job_queue.empty()) { return; }
-		has_work = true;
+		{
+			std::lock_guard lock(start_mtx);
+			has_work = true;
+			++generation;
+		}
 		start_cv.notify_all();
 	}
 
+	/// @brief Blocks until every job is done and no worker touches the queue anymore
 	void wait() {
 		if (job_queue.empty()) return;
+		// workers leave the batch only after their last job, so no active worker and all jobs taken means done
+		{
+			std::unique_lock lock(done_mtx);
+			done_cv.wait(lock, [this]() {
+				return active == 0 && jobs_taken.load(std::memory_order_acquire) >= job_queue.size();
+			});
+		}
+		{
+			std::lock_guard lock(start_mtx);
+			has_work = false;
+		}
 		{
 			std::unique_lock lock(done_mtx);
-			done_cv.wait(lock, [this]() { return jobs_done.load(std::memory_order_acquire) >= job_queue.size(); });
+			done_cv.wait(lock, [this]() { return active == 0; });
 		}
 		assert(jobs_done.load(std::memory_order_acquire) == job_queue.size());
 		job_queue.clear();
@@ -96,7 +131,10 @@ class OneShotThreadPool {
 	}
 
 	void stop() {
-		running = false;
+		{
+			std::lock_guard lock(start_mtx);
+			running = false;
+		}
 		start_cv.notify_all();
 		for (auto &thread : threads) {
 			if (thread.joinable()) { thread.join(); }
@@ -109,3 +147,78 @@ class OneShotThreadPool {
 
 	inline constexpr uint getNumThreads() const { return num_threads; }
 };
+
+/**
+ * Runs tasks one after another on a single background thread, in the order they were pushed.
+ * Used to take output (encoding, writing files) off the render threads.
+ * push() blocks while \a capacity tasks are already waiting, which bounds the memory held by queued images.
+ */
+class SerialWorker {
+	std::deque<std::function<void()>> tasks;
+	std::size_t						  capacity;
+	std::string						  name;	   ///< of the thread in traces
+	bool							  busy	   = false;
+	bool							  stopping = false;
+
+	std::mutex				mtx;
+	std::condition_variable cv;
+	std::thread				thread;
+
+	void run() {
+		trace::setThreadName(name);
+		std::unique_lock lock(mtx);
+		while (true) {
+			{
+				trace::Zone idle("Idle");
+				cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			}
+			if (tasks.empty()) return;
+
+			auto task = std::move(tasks.front());
+			tasks.pop_front();
+			busy = true;
+			lock.unlock();
+			cv.notify_all();
+			try {
+				task();
+			} catch (const std::exception &e) { dbLog(dbg::LOG_ERROR, "Background task failed: ", e.what()); }
+			lock.lock();
+			busy = false;
+			cv.notify_all();
+		}
+	}
+
+   public:
+	SerialWorker(std::size_t capacity = 2, std::string name = "Background")
+		: capacity(std::max<std::size_t>(capacity, 1)), name(std::move(name)) {
+		thread = std::thread(&SerialWorker::run, this);
+	}
+
+	SerialWorker(const SerialWorker &)			  = delete;
+	SerialWorker &operator=(const SerialWorker &) = delete;
+
+	/// @brief finishes all queued tasks and stops the thread
+	~SerialWorker() {
+		{
+			std::lock_guard lock(mtx);
+			stopping = true;
+		}
+		cv.notify_all();
+		if (thread.joinable()) thread.join();
+	}
+
+	void push(std::function<void()> &&task) {
+		{
+			std::unique_lock lock(mtx);
+			cv.wait(lock, [this]() { return tasks.size() < capacity; });
+			tasks.push_back(std::move(task));
+		}
+		cv.notify_all();
+	}
+
+	/// @brief blocks until every pushed task has finished
+	void wait() {
+		std::unique_lock lock(mtx);
+		cv.wait(lock, [this]() { return tasks.empty() && !busy; });
+	}
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+#include <myglm/myglm.h>
+#include <log.hpp>
+
+/// A rectangle of pixels rendered by one job. \a index is the position of the tile in the row-major tile grid.
+struct Tile {
+	ivec2	 min;
+	ivec2	 max;
+	uint32_t index;
+};
+
+enum class TileOrder { Scanline, Morton, Hilbert };
+
+inline TileOrder tileOrderFromString(std::string_view name) {
+	if (name == "scanline") return TileOrder::Scanline;
+	if (name == "morton") return TileOrder::Morton;
+	if (name == "hilbert") return TileOrder::Hilbert;
+	throw std::runtime_error("Unknown tile order: " + std::string(name));
+}
+
+/// interleaves the bits of x and y, x in the even bits
+inline constexpr uint32_t mortonEncode(uint32_t x, uint32_t y) {
+	auto part1by1 = [](uint32_t v) {
+		v &= 0x0000ffff;
+		v = (v | (v << 8)) & 0x00ff00ff;
+		v = (v | (v << 4)) & 0x0f0f0f0f;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	};
+	return part1by1(x) | (part1by1(y) << 1);
+}
+
+/// distance of (x, y) along the Hilbert curve filling a \a n x \a n grid, \a n must be a power of two
+inline constexpr uint32_t hilbertIndex(uint32_t n, uint32_t x, uint32_t y) {
+	uint32_t d = 0;
+	for (uint32_t s = n / 2; s > 0; s /= 2) {
+		uint32_t rx = (x & s) > 0;
+		uint32_t ry = (y & s) > 0;
+		d += s * s * ((3 * rx) ^ ry);
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+/**
+ * Splits the image into tiles and decides the order in which they are rendered.
+ *
+ * Without measurements, tiles follow a space filling curve so that consecutive jobs touch nearby geometry.
+ * After a pass reports its per-tile costs with update(), the next pass with the same tiling starts with the
+ * most expensive tiles, so that the frame does not end with one thread rendering the last glass tile alone.
+ *
+ * With autotuning, the initial tile size is the largest power of two giving every thread enough tiles. It is
+ * halved when a single tile takes a large share of a thread's work and doubled when tiles are so cheap that
+ * the job overhead starts to matter.
+ */
+class TileScheduler {
+	TileOrder order		= TileOrder::Hilbert;
+	int		  tileSize	= 32;
+	bool	  autotune	= true;
+	ivec2	  resolution = ivec2(0, 0);
+	uint32_t  threads	= 1;
+
+	std::vector<Tile>  tiles;	  ///< in the order they should be scheduled
+	std::vector<float> costs;	  ///< last measured cost of every tile by Tile::index, empty if unknown
+
+	static constexpr int MIN_TILE_SIZE	  = 8;
+	static constexpr int MAX_TILE_SIZE	  = 128;
+	// autotuning aims for at least that many tiles per thread
+	static constexpr int TILES_PER_THREAD = 8;
+	// a tile taking more than that fraction of a thread's share of the pass makes the tail too long
+	static constexpr float TAIL_FRACTION = 0.25f;
+	// tiles cheaper than that (in seconds) are dominated by the cost of scheduling them
+	static constexpr float MIN_TILE_COST = 200e-6f;
+
+	inline ivec2 gridSize(int size) const { return (resolution + size - 1) / size; }
+
+	inline std::size_t tileCount(int size) const {
+		auto grid = gridSize(size);
+		return std::size_t(grid.x) * grid.y;
+	}
+
+	void build() {
+		const ivec2 grid = gridSize(tileSize);
+		tiles.clear();
+		tiles.reserve(tileCount(tileSize));
+		for (int y = 0; y < grid.y; ++y) {
+			for (int x = 0; x < grid.x; ++x) {
+				const auto lo = ivec2(x, y) * tileSize;
+				tiles.push_back(Tile{lo, ::min(lo + tileSize, resolution), uint32_t(y * grid.x + x)});
+			}
+		}
+
+		const uint32_t n   = std::bit_ceil(uint32_t(std::max(grid.x, grid.y)));
+		auto		   key = [&](const Tile &t) -> uint32_t {
+			  uint32_t x = t.index % grid.x, y = t.index / grid.x;
+			  switch (order) {
+				  case TileOrder::Morton: return mortonEncode(x, y);
+				  case TileOrder::Hilbert: return hilbertIndex(n, x, y);
+				  default: return t.index;
+			  }
+		};
+		std::ranges::sort(tiles, {}, key);
+		costs.clear();
+	}
+
+   public:
+	TileScheduler() = default;
+
+	/// @param tileSize - edge length of the tiles in pixels, 0 to pick it automatically
+	void setTiling(int tileSize, TileOrder order) {
+		this->autotune = tileSize <= 0;
+		this->tileSize = autotune ? 32 : tileSize;
+		this->order	   = order;
+		this->resolution = ivec2(0, 0);
+	}
+
+	/// @brief Prepares the tiles for an image of the given size rendered by \a threads threads
+	void configure(ivec2 resolution, uint32_t threads) {
+		if (resolution == this->resolution && threads == this->threads && !tiles.empty()) return;
+		this->resolution = resolution;
+		this->threads	 = std::max(threads, 1u);
+		if (autotune) {
+			tileSize = MAX_TILE_SIZE;
+			while (tileSize > MIN_TILE_SIZE && tileCount(tileSize) < this->threads * TILES_PER_THREAD) {
+				tileSize /= 2;
+			}
+		}
+		build();
+	}
+
+	/// @brief Reports the measured cost of every tile (by Tile::index) of the last pass, in seconds
+	void update(std::vector<float> &&measured) {
+		if (measured.size() != tiles.size()) return;
+
+		if (autotune) {
+			float total = std::accumulate(measured.begin(), measured.end(), 0.f);
+			float worst = std::ranges::max(measured);
+			int	  size	= tileSize;
+			if (worst > total / threads * TAIL_FRACTION && size > MIN_TILE_SIZE) size /= 2;
+			// doubling the edge makes the worst tile up to 4 times as expensive, which must not cause a tail
+			else if (total / measured.size() < MIN_TILE_COST && worst * 4 <= total / threads * TAIL_FRACTION &&
+					 size < MAX_TILE_SIZE && tileCount(size * 2) >= threads * TILES_PER_THREAD) {
+				size *= 2;
+			}
+			if (size != tileSize) {
+				dbLog(dbg::LOG_DEBUG, "Tile size changed from ", tileSize, " to ", size);
+				tileSize = size;
+				build();
+				return;
+			}
+		}
+
+		costs = std::move(measured);
+		std::ranges::stable_sort(tiles, std::greater<>{}, [&](const Tile &t) { return costs[t.index]; });
+	}
+
+	inline const std::vector<Tile> &getTiles() const { return tiles; }
+	inline std::size_t				size() const { return tiles.size(); }
+	inline int						getTileSize() const { return tileSize; }
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <log.hpp>
+
+/*
+ * Timeline tracing with scoped zones, written as Chrome trace JSON that chrome://tracing and Perfetto
+ * (ui.perfetto.dev) load. Tracing is off until start() is called, a Zone then costs a relaxed load. While it is on,
+ * every thread records its finished zones into its own ring buffer without any locking. When a buffer is full, the
+ * oldest zones of that thread are overwritten. write() should only be called while the traced threads are idle.
+ */
+namespace trace {
+
+/// zones kept per thread, about 2.5 MB
+inline constexpr std::size_t RING_SIZE = 1 << 16;
+
+struct Event {
+	const char *name;
+	const char *argName;	 ///< name of the single argument, nullptr for none
+	int64_t		arg;
+	uint64_t	start;	   ///< steady clock nanoseconds
+	uint64_t	end;
+};
+
+struct ThreadBuffer {
+	std::vector<Event>	 events = std::vector<Event>(RING_SIZE);
+	std::atomic_uint64_t written = 0;	  ///< events recorded so far, the last RING_SIZE of them are kept
+	uint32_t			 id		 = 0;
+	std::string			 name;	   ///< guarded by the registry mutex
+};
+
+struct Registry {
+	std::mutex								   mutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> threads;	 ///< kept after their thread exits
+	uint64_t								   startTime = 0;
+};
+
+inline std::atomic_bool enabled = false;
+
+inline Registry &registry() {
+	static Registry r;
+	return r;
+}
+
+inline uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+/// @brief The buffer of the calling thread, registered when it is first used
+inline ThreadBuffer &local() {
+	static thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+		auto  b = std::make_shared<ThreadBuffer>();
+		auto &r = registry();
+		std::lock_guard lock(r.mutex);
+		b->id = r.threads.size() + 1;
+		r.threads.push_back(b);
+		return b;
+	}();
+	return *buffer;
+}
+
+inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+/// @brief Starts recording zones, the timestamps of the trace count from here
+inline void start() {
+	{
+		auto &r = registry();
+		std::lock_guard lock(r.mutex);
+		r.startTime = now();
+	}
+	enabled.store(true, std::memory_order_relaxed);
+}
+
+/// @brief Names the calling thread in the trace, does nothing while tracing is off
+inline void setThreadName(std::string name) {
+	if (!isEnabled()) return;
+	auto		   &buffer = local();
+	std::lock_guard lock(registry().mutex);
+	buffer.name = std::move(name);
+}
+
+inline void record(const char *name, const char *argName, int64_t arg, uint64_t start, uint64_t end) {
+	auto		  &buffer = local();
+	const uint64_t i	  = buffer.written.load(std::memory_order_relaxed);
+	buffer.events[i % RING_SIZE] = Event{name, argName, arg, start, end};
+	buffer.written.store(i + 1, std::memory_order_release);
+}
+
+/// Records the time between its construction and destruction as a zone of the calling thread. \a name and
+/// \a argName must be string literals, they are written to the trace as they are.
+class Zone {
+	const char *name;
+	const char *argName;
+	int64_t		arg;
+	uint64_t	start;
+	bool		active;
+
+   public:
+	explicit Zone(const char *name, const char *argName = nullptr, int64_t arg = 0)
+		: name(name), argName(argName), arg(arg), start(0), active(isEnabled()) {
+		if (active) start = now();
+	}
+	~Zone() {
+		if (active) record(name, argName, arg, start, now());
+	}
+	Zone(const Zone &)			  = delete;
+	Zone &operator=(const Zone &) = delete;
+};
+
+/// @brief Writes the zones recorded since start() to \a filename as Chrome trace JSON
+inline void write(const std::string &filename) {
+	std::ofstream out(filename);
+	if (!out) { throw std::runtime_error("Failed to open trace file for writing: " + filename); }
+
+	auto		   &r = registry();
+	std::lock_guard lock(r.mutex);
+	// names are literals and thread names are ours, only quotes and backslashes would need escaping
+	auto quoted = [](const std::string &s) {
+		std::string q = "\"";
+		for (char c : s) {
+			if (c == '"' || c == '\\') q += '\\';
+			q += c;
+		}
+		return q + '"';
+	};
+	auto micros = [&](uint64_t ns) { return double(ns - std::min(ns, r.startTime)) / 1000.0; };
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"beamcast\"}}";
+	std::size_t count = 0, dropped = 0;
+	for (const auto &thread : r.threads) {
+		const std::string name = thread->name.empty() ? "Thread " + std::to_string(thread->id) : thread->name;
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+			<< ",\"args\":{\"name\":" << quoted(name) << "}}";
+		out << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+			<< ",\"args\":{\"sort_index\":" << thread->id << "}}";
+
+		const uint64_t written = thread->written.load(std::memory_order_acquire);
+		const uint64_t first   = written > RING_SIZE ? written - RING_SIZE : 0;
+		dropped += first;
+		for (uint64_t i = first; i < written; ++i) {
+			const Event &e = thread->events[i % RING_SIZE];
+			if (e.start < r.startTime) continue;	 // recorded before a restart
+			out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+				<< ",\"ts\":" << micros(e.start) << ",\"dur\":" << double(e.end - e.start) / 1000.0;
+			if (e.argName) out << ",\"args\":{\"" << e.argName << "\":" << e.arg << "}";
+			out << "}";
+			++count;
+		}
+	}
+	out << "\n]}\n";
+	if (!out) { throw std::runtime_error("Failed to write trace file: " + filename); }
+
+	if (dropped) {
+		dbLog(dbg::LOG_WARNING, "Trace ring buffers overflowed, the oldest ", dropped, " zones are missing");
+	}
+	dbLog(dbg::LOG_INFO, "Trace with ", count, " zones of ", r.threads.size(), " threads saved to ", filename);
+}
+}	  // namespace trace
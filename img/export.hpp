@@ -1,8 +1,34 @@
 #pragma once
 
+#include <array>
 #include <fstream>
+#include <img/exr.hpp>
 #include <img/image.hpp>
-#include <stb_image_write.h>
+#include <img/png.hpp>
+
+enum class ImageFormat { PNG, PFM, EXR };
+
+inline ImageFormat imageFormatFromString(std::string_view name) {
+	if (name == "png") return ImageFormat::PNG;
+	if (name == "pfm") return ImageFormat::PFM;
+	if (name == "exr") return ImageFormat::EXR;
+	throw std::runtime_error("Unknown image format: " + std::string(name));
+}
+
+inline std::string_view imageFormatExtension(ImageFormat format) {
+	switch (format) {
+		case ImageFormat::PFM: return "pfm";
+		case ImageFormat::EXR: return "exr";
+		default: return "png";
+	}
+}
+
+/// @brief Picks the format from the extension of \a filename, PNG for anything unknown
+inline ImageFormat imageFormatFromFilename(std::string_view filename) {
+	if (filename.ends_with(".pfm")) return ImageFormat::PFM;
+	if (filename.ends_with(".exr")) return ImageFormat::EXR;
+	return ImageFormat::PNG;
+}
 
 template <class ColorFormat>
 struct export_PPM {
@@ -40,6 +66,51 @@ struct export_PPM_BIN {
 	}
 };
 
+/// Portable float map, the rgb channels as 32 bit floats without clamping
+template <class ColorFormat>
+struct export_PFM {
+	auto operator()(const Image<ColorFormat>& image, std::ostream& out) {
+		if (!out) return false;
+
+		// the negative scale marks little endian samples
+		out << "PF\n";
+		out << image.getWidth() << ' ' << image.getHeight() << '\n';
+		out << "-1.0\n";
+
+		// rows go from the bottom to the top, one row is converted at a time
+		std::vector<float> row(image.getWidth() * 3);
+		for (std::size_t y = image.getHeight(); y-- > 0;) {
+			for (std::size_t x = 0; x < image.getWidth(); ++x) {
+				auto converted = convert<ColorFormat, RGB32F>(image(x, y));
+				row[x * 3]	   = converted.x;
+				row[x * 3 + 1] = converted.y;
+				row[x * 3 + 2] = converted.z;
+			}
+			out.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+		}
+		return true;
+	}
+};
+
+inline constexpr std::array<std::string_view, 4> EXR_RGBA_CHANNELS = {"R", "G", "B", "A"};
+
+/// OpenEXR with 32 bit float RGBA channels, see ExrWriter for images with AOV layers
+template <class ColorFormat>
+struct export_EXR {
+	static_assert(std::is_same_v<ColorFormat, RGBA32F>, "EXR export needs an RGBA32F image");
+
+	ExrCompression compression = ExrCompression::ZIP;
+
+	auto operator()(const Image<ColorFormat>& image, std::ostream& out) {
+		if (!out) return false;
+
+		ExrWriter writer(image.getWidth(), image.getHeight(), compression);
+		writer.addChannels(image, "", EXR_RGBA_CHANNELS);
+		writer.write(out);
+		return bool(out);
+	}
+};
+
 template <class Exporter, class ColorFormat>
 inline void exportToFile(const Image<ColorFormat>& img, const std::string_view& filename) {
 	std::ofstream out(filename.data(), std::ios::binary);
@@ -49,21 +120,17 @@ inline void exportToFile(const Image<ColorFormat>& img, const std::string_view&
 
 class export_PNG {};
 
+/// PNG files are encoded by PngWriter on several threads with the settings in pngSettings
 template <>
 inline void exportToFile<export_PNG, RGBA>(const Image<RGBA>& img, const std::string_view& filename) {
-	stbi_write_png(filename.data(), img.getWidth(), img.getHeight(), 4, img.data(), img.getWidth() * sizeof(RGBA));
+	std::ofstream out(filename.data(), std::ios::binary);
+	if (!out) { throw std::runtime_error("Failed to open file for writing: " + std::string(filename)); }
+	PngWriter().write(img, out);
 }
 
 template <>
 inline void exportToFile<export_PNG, RGBA32F>(const Image<RGBA32F>& img, const std::string_view& filename) {
-	uint8_t* data = new uint8_t[img.getWidth() * img.getHeight() * 4];
-	for (size_t i = 0; i < img.getWidth() * img.getHeight(); ++i) {
-		auto converted = convert<RGBA32F, RGBA>(img[i]);
-		data[(i << 2)] = converted[0];
-		data[(i << 2) + 1] = converted[1];
-		data[(i << 2) + 2] = converted[2];
-		data[(i << 2) + 3] = converted[3];
-	}
-	stbi_write_png(filename.data(), img.getWidth(), img.getHeight(), 4, data, img.getWidth() * sizeof(RGBA));
-	delete[] data;
+	std::ofstream out(filename.data(), std::ios::binary);
+	if (!out) { throw std::runtime_error("Failed to open file for writing: " + std::string(filename)); }
+	PngWriter().write(img, out);
 }
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <img/image.hpp>
+
+// part of the stb_image_write implementation in image.cpp, but not declared by its header
+extern "C" unsigned char *stbi_zlib_compress(unsigned char *data, int data_len, int *out_len, int quality);
+
+enum class ExrCompression : uint8_t { None = 0, RLE = 1, ZIP = 3 };
+enum class ExrPixelType : int32_t { Half = 1, Float = 2 };
+
+/**
+ * Writes single part scanline OpenEXR files without depending on OpenEXR.
+ *
+ * Channels are read directly from the images they are added from, one block of scanlines at a time, so no copy of
+ * the whole image is made. Channels of AOVs go into layers ("normal.X", "depth.Z", ...) next to the "R", "G", "B"
+ * and "A" channels of the main image. RLE and ZIP blocks use the same byte reordering and delta predictor as
+ * OpenEXR, ZIP uses the deflate implementation of stb_image_write.
+ */
+class ExrWriter {
+	static_assert(std::endian::native == std::endian::little, "EXR files are little endian");
+
+	struct Channel {
+		std::string	 name;
+		const float *data;
+		std::size_t	 stride;	 ///< floats from one pixel to the next
+	};
+
+	std::size_t			 width, height;
+	ExrCompression		 compression;
+	ExrPixelType		 pixelType;
+	std::vector<Channel> channels;
+
+	static constexpr int MAGIC		 = 20000630;
+	static constexpr int VERSION	 = 2;
+	static constexpr int ZIP_QUALITY = 8;
+
+	template <class T>
+	static void put(std::string &buf, const T &value) {
+		buf.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	static void attribute(std::ostream &out, std::string_view name, std::string_view type, const std::string &value) {
+		out << name << '\0' << type << '\0';
+		const int32_t size = value.size();
+		out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+		out.write(value.data(), value.size());
+	}
+
+	inline std::size_t linesPerBlock() const { return compression == ExrCompression::ZIP ? 16 : 1; }
+	inline std::size_t bytesPerSample() const { return pixelType == ExrPixelType::Half ? 2 : 4; }
+
+	void writeHeader(std::ostream &out) const {
+		out.write(reinterpret_cast<const char *>(&MAGIC), sizeof(MAGIC));
+		out.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+
+		std::string value;
+		for (const auto &c : channels) {
+			value += c.name;
+			value += '\0';
+			put(value, int32_t(pixelType));
+			put(value, uint32_t(0));	 // pLinear and 3 reserved bytes
+			put(value, int32_t(1));		 // x and y sampling
+			put(value, int32_t(1));
+		}
+		value += '\0';
+		attribute(out, "channels", "chlist", value);
+
+		value.clear();
+		put(value, uint8_t(compression));
+		attribute(out, "compression", "compression", value);
+
+		value.clear();
+		put(value, int32_t(0));
+		put(value, int32_t(0));
+		put(value, int32_t(width - 1));
+		put(value, int32_t(height - 1));
+		attribute(out, "dataWindow", "box2i", value);
+		attribute(out, "displayWindow", "box2i", value);
+
+		value.clear();
+		put(value, uint8_t(0));	 // increasing y
+		attribute(out, "lineOrder", "lineOrder", value);
+
+		value.clear();
+		put(value, 1.f);
+		attribute(out, "pixelAspectRatio", "float", value);
+		attribute(out, "screenWindowWidth", "float", value);
+
+		value.clear();
+		put(value, 0.f);
+		put(value, 0.f);
+		attribute(out, "screenWindowCenter", "v2f", value);
+
+		out.put('\0');
+	}
+
+	/// @brief Writes the scanlines [y, y + lines) to \a raw, for each line every channel in turn
+	void fillBlock(std::size_t y, std::size_t lines, std::vector<uint8_t> &raw) const {
+		raw.resize(lines * channels.size() * width * bytesPerSample());
+		uint8_t *dst = raw.data();
+		for (std::size_t line = y; line < y + lines; ++line) {
+			for (const auto &c : channels) {
+				const float *src = c.data + line * width * c.stride;
+				if (pixelType == ExrPixelType::Float) {
+					for (std::size_t x = 0; x < width; ++x, dst += 4) std::memcpy(dst, src + x * c.stride, 4);
+				} else {
+					for (std::size_t x = 0; x < width; ++x, dst += 2) {
+						const uint16_t half = _cvtss_sh(src[x * c.stride], _MM_FROUND_TO_NEAREST_INT);
+						std::memcpy(dst, &half, 2);
+					}
+				}
+			}
+		}
+	}
+
+	/// @brief Splits the bytes into even and odd ones and replaces them by their differences, as OpenEXR does
+	static void predict(const std::vector<uint8_t> &raw, std::vector<uint8_t> &out) {
+		out.resize(raw.size());
+		const std::size_t half = (raw.size() + 1) / 2;
+		for (std::size_t i = 0; i < raw.size(); ++i) out[(i & 1) ? half + i / 2 : i / 2] = raw[i];
+		for (std::size_t i = out.size() - 1; i > 0; --i) out[i] = uint8_t(int(out[i]) - int(out[i - 1]) + 128);
+	}
+
+	/// runs of 3 to 128 equal bytes are stored as (length - 1, byte), other bytes as (-count, bytes...)
+	static void runLengthEncode(const std::vector<uint8_t> &in, std::vector<uint8_t> &out) {
+		constexpr std::size_t MIN_RUN = 3, MAX_RUN = 127;
+		out.clear();
+		std::size_t start = 0;
+		while (start < in.size()) {
+			std::size_t end = start + 1;
+			while (end < in.size() && in[end] == in[start] && end - start - 1 < MAX_RUN) ++end;
+			if (end - start >= MIN_RUN) {
+				out.push_back(uint8_t(end - start - 1));
+				out.push_back(in[start]);
+			} else {
+				// extend the literal run until the next run of at least 3 equal bytes
+				while (end < in.size() && end - start < MAX_RUN &&
+					   (end + 2 >= in.size() || in[end] != in[end + 1] || in[end + 1] != in[end + 2])) {
+					++end;
+				}
+				out.push_back(uint8_t(-int(end - start)));
+				out.insert(out.end(), in.begin() + start, in.begin() + end);
+			}
+			start = end;
+		}
+	}
+
+	/// @brief Compresses \a raw into \a packed, returns false if the block is better stored uncompressed
+	bool compress(const std::vector<uint8_t> &raw, std::vector<uint8_t> &scratch, std::vector<uint8_t> &packed) const {
+		if (compression == ExrCompression::None || raw.empty()) return false;
+		predict(raw, scratch);
+		if (compression == ExrCompression::RLE) {
+			runLengthEncode(scratch, packed);
+		} else {
+			int		 size = 0;
+			uint8_t *zlib = stbi_zlib_compress(scratch.data(), scratch.size(), &size, ZIP_QUALITY);
+			if (!zlib) return false;
+			packed.assign(zlib, zlib + size);
+			std::free(zlib);
+		}
+		return packed.size() < raw.size();
+	}
+
+   public:
+	ExrWriter(std::size_t width, std::size_t height, ExrCompression compression = ExrCompression::ZIP,
+			  ExrPixelType pixelType = ExrPixelType::Float)
+		: width(width), height(height), compression(compression), pixelType(pixelType) {}
+
+	/**
+	 * @brief Adds the first names.size() components of every pixel of \a img as channels. \a img has to stay
+	 * alive until write().
+	 * @param layer - prefix of the channel names, empty for the main image
+	 */
+	void addChannels(const Image<RGBA32F> &img, std::string_view layer, std::span<const std::string_view> names) {
+		if (img.getWidth() != width || img.getHeight() != height) {
+			throw std::runtime_error("EXR channel size does not match the image size");
+		}
+		for (std::size_t i = 0; i < std::min<std::size_t>(names.size(), 4); ++i) {
+			std::string name = layer.empty() ? std::string(names[i]) : std::string(layer) + "." + std::string(names[i]);
+			channels.push_back(Channel{std::move(name), img.data()->data + i, 4});
+		}
+	}
+
+	/// @brief Writes the file, \a out has to be seekable since the chunk offsets precede the chunks
+	void write(std::ostream &out) {
+		// channels and the pixel data in every scanline are sorted by name
+		std::ranges::stable_sort(channels, {}, &Channel::name);
+
+		const auto start = out.tellp();
+		writeHeader(out);
+
+		const std::size_t	  blocks = (height + linesPerBlock() - 1) / linesPerBlock();
+		std::vector<uint64_t> offsets(blocks, 0);
+		const auto			  table = out.tellp();
+		out.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+		std::vector<uint8_t> raw, scratch, packed;
+		for (std::size_t block = 0; block < blocks; ++block) {
+			const std::size_t y = block * linesPerBlock();
+			fillBlock(y, std::min(linesPerBlock(), height - y), raw);
+			const auto &data = compress(raw, scratch, packed) ? packed : raw;
+
+			offsets[block]		= uint64_t(out.tellp() - start);
+			const int32_t ys[2] = {int32_t(y), int32_t(data.size())};
+			out.write(reinterpret_cast<const char *>(ys), sizeof(ys));
+			out.write(reinterpret_cast<const char *>(data.data()), data.size());
+		}
+
+		const auto end = out.tellp();
+		out.seekp(table);
+		out.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+		out.seekp(end);
+	}
+};
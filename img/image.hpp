@@ -1,5 +1,6 @@
 #pragma once
 
+#include <immintrin.h>
 #include <myglm/myglm.h>
 #include <ranges>
 #include <json/json.hpp>
@@ -129,6 +130,28 @@ inline constexpr RGBA convert<RGBA32F, RGBA>(const RGBA32F& color) {
 				static_cast<uint8_t>(std::clamp(color.w, 0.f, 1.f) * 255.0f)};
 }
 
+/// @brief Converts \a count pixels like convert<RGBA32F, RGBA>, 8 at a time with AVX2
+inline void convertRow(const RGBA32F *src, RGBA *dst, std::size_t count) {
+	const __m256  zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f), scale = _mm256_set1_ps(255.f);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	// the second operand of max is returned for NaN, so NaN becomes 0
+	auto quantize = [&](const float *p) {
+		__m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(p), zero), one);
+		return _mm256_cvttps_epi32(_mm256_mul_ps(v, scale));
+	};
+
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const float *p = src[i].data;
+		// packing works per 128 bit lane, which leaves the pixels in the order 0 2 4 6 1 3 5 7
+		__m256i lo = _mm256_packus_epi32(quantize(p), quantize(p + 8));
+		__m256i hi = _mm256_packus_epi32(quantize(p + 16), quantize(p + 24));
+		__m256i px = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), px);
+	}
+	for (; i < count; ++i) dst[i] = convert<RGBA32F, RGBA>(src[i]);
+}
+
 inline auto segmentImage(const ivec2 resolution, const ivec2 segmentSize) {
 	const ivec2 segments = (resolution + segmentSize - 1) / segmentSize;
 	return std::views::cartesian_product(std::views::iota(0, segments.x), std::views::iota(0, segments.y)) |
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <img/image.hpp>
+#include <img/tiled.hpp>
+
+/// How a MipMap is sampled. Nearest reads one texel of the full size image, bilinear interpolates 4 texels of the
+/// mip level closest to the footprint, trilinear blends the bilinear samples of the two levels around it.
+enum class TextureFilter { Nearest, Bilinear, Trilinear };
+
+inline TextureFilter textureFilterFromString(std::string_view name) {
+	if (name == "nearest") return TextureFilter::Nearest;
+	if (name == "bilinear") return TextureFilter::Bilinear;
+	if (name == "trilinear") return TextureFilter::Trilinear;
+	throw std::runtime_error("Unknown texture filter: " + std::string(name));
+}
+
+/// What the 8 bit texels of a MipMap encode. Linear texels are divided by 255 like convert<RGBA, RGB32F>, SRGB texels
+/// are decoded with the sRGB transfer function, which keeps more precision in dark colors. Alpha is always linear.
+enum class ColorSpace { Linear, SRGB };
+
+inline ColorSpace colorSpaceFromString(std::string_view name) {
+	if (name == "linear") return ColorSpace::Linear;
+	if (name == "srgb") return ColorSpace::SRGB;
+	throw std::runtime_error("Unknown color space: " + std::string(name));
+}
+
+/// linear value of every 8 bit sRGB value
+inline const std::array<float, 256> SRGB_TO_LINEAR = [] {
+	std::array<float, 256> table;
+	for (int i = 0; i < 256; ++i) {
+		const float v = i / 255.f;
+		table[i]	  = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+	}
+	return table;
+}();
+
+/// @brief Linear color of an 8 bit texel encoded in \a space
+inline __m128 decodeTexel(RGBA texel, ColorSpace space) {
+	int bits;
+	std::memcpy(&bits, &texel, sizeof(bits));
+	const __m128i channels = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bits));
+	const __m128  linear   = _mm_mul_ps(_mm_cvtepi32_ps(channels), _mm_set1_ps(1.f / 255.f));
+	if (space == ColorSpace::Linear) return linear;
+	return _mm_blend_ps(_mm_i32gather_ps(SRGB_TO_LINEAR.data(), channels, 4), linear, 0b1000);
+}
+
+/// @brief The 8 bit value in \a space closest to \a value
+inline uint8_t encodeChannel(float value, ColorSpace space) {
+	value = std::clamp(value, 0.f, 1.f);
+	if (space == ColorSpace::Linear) return uint8_t(value * 255.f + 0.5f);
+	// the closest entry of the decoding table
+	const auto next = std::lower_bound(SRGB_TO_LINEAR.begin(), SRGB_TO_LINEAR.end(), value);
+	if (next == SRGB_TO_LINEAR.begin()) return 0;
+	if (next == SRGB_TO_LINEAR.end()) return 255;
+	const auto i = next - SRGB_TO_LINEAR.begin();
+	return uint8_t(value - next[-1] < *next - value ? i - 1 : i);
+}
+
+/*
+ * Texture filtering of any store of mip levels of 8 bit texels. A TexelSource has levelCount(), levelWidth(level),
+ * levelHeight(level), lodBias() (log2 of the full size texels per unit of texture coordinates), getColorSpace() and
+ * texel(level, x, y). Texture coordinates are clamped to [0, 1] like Image::sample(), the texel centers are at
+ * (i + 0.5) / size.
+ */
+namespace texfilter {
+template <class TexelSource>
+inline __m128 load(const TexelSource &source, std::size_t level, int x, int y) {
+	return decodeTexel(source.texel(level, x, y), source.getColorSpace());
+}
+
+template <class TexelSource>
+__m128 nearest(const TexelSource &source, vec2 uv) {
+	const int w = int(source.levelWidth(0)), h = int(source.levelHeight(0));
+	return load(source, 0, std::min(int(uv.x * w), w - 1), std::min(int(uv.y * h), h - 1));
+}
+
+template <class TexelSource>
+__m128 bilinear(const TexelSource &source, std::size_t level, vec2 uv) {
+	const int	w = int(source.levelWidth(level)), h = int(source.levelHeight(level));
+	const float x = uv.x * w - 0.5f, y = uv.y * h - 0.5f;
+	const float fx = std::floor(x), fy = std::floor(y);
+	const int	x0 = std::clamp(int(fx), 0, w - 1), x1 = std::clamp(int(fx) + 1, 0, w - 1);
+	const int	y0 = std::clamp(int(fy), 0, h - 1), y1 = std::clamp(int(fy) + 1, 0, h - 1);
+
+	const __m128 tx	 = _mm_set1_ps(x - fx);
+	const __m128 a	 = load(source, level, x0, y0);
+	const __m128 b	 = load(source, level, x0, y1);
+	const __m128 top = _mm_fmadd_ps(_mm_sub_ps(load(source, level, x1, y0), a), tx, a);
+	const __m128 bot = _mm_fmadd_ps(_mm_sub_ps(load(source, level, x1, y1), b), tx, b);
+	return _mm_fmadd_ps(_mm_sub_ps(bot, top), _mm_set1_ps(y - fy), top);
+}
+
+/// @brief The mip level whose texels are as large as \a footprint, a width in texture coordinates. Negative when
+/// the full size texels are larger, 0 for no footprint.
+template <class TexelSource>
+inline float lod(const TexelSource &source, float footprint) {
+	if (footprint <= 0.f) return 0.f;
+	return fast::log2(footprint) + source.lodBias();
+}
+
+/// @brief Filtered color at \a uv as an SSE vector, so that it is returned in one register
+/// @param footprint - width of the area to average in texture coordinates
+template <class TexelSource>
+__m128 sample(const TexelSource &source, vec2 uv, float footprint, TextureFilter filter) {
+	uv = clamp(uv, 0.f, 1.f);
+	if (filter == TextureFilter::Nearest) return nearest(source, uv);
+
+	const float lastLevel = float(source.levelCount() - 1);
+	const float l		  = std::clamp(lod(source, footprint), 0.f, lastLevel);
+	if (filter == TextureFilter::Bilinear) return bilinear(source, std::size_t(l + 0.5f), uv);
+
+	const std::size_t l0	 = std::size_t(l);
+	const float		  weight = l - float(l0);
+	const __m128	  a		 = bilinear(source, l0, uv);
+	if (weight == 0.f) return a;
+	const __m128 b = bilinear(source, l0 + 1, uv);
+	return _mm_fmadd_ps(_mm_sub_ps(b, a), _mm_set1_ps(weight), a);
+}
+}	  // namespace texfilter
+
+/**
+ * An image and its mip levels, each half the size of the previous one down to 1x1, averaged with a 2x2 box filter.
+ * Texels are 8 bit RGBA in 8x8 tiles, a quarter of the memory of float texels, and decoded with SSE when they are
+ * sampled, see texfilter.
+ */
+class MipMap {
+	using Level = TiledImage<RGBA>;
+	static_assert(sizeof(RGBA) == 4);
+
+	std::vector<Level> levels;
+	ColorSpace		   colorSpace = ColorSpace::Linear;
+	float			   bias		  = 0;	   ///< log2 of the texels per unit of texture coordinates
+
+	inline RGBA encode(__m128 color) const {
+		RGBA32F c;
+		_mm_storeu_ps(c.data, color);
+		return RGBA{encodeChannel(c.x, colorSpace), encodeChannel(c.y, colorSpace), encodeChannel(c.z, colorSpace),
+					encodeChannel(c.w, ColorSpace::Linear)};
+	}
+
+   public:
+	MipMap() = default;
+
+	template <class ColorFormat>
+	explicit MipMap(const Image<ColorFormat> &image, ColorSpace colorSpace = ColorSpace::Linear) {
+		build(image, colorSpace);
+	}
+
+	/// @brief Replaces the levels with \a image and its mip levels. 8 bit images are taken to be in \a space
+	/// already and are stored as they are, float images are encoded. Every level is averaged from the full precision
+	/// colors of the one before, so the 8 bit rounding of the levels does not add up.
+	template <class ColorFormat>
+	void build(const Image<ColorFormat> &image, ColorSpace space = ColorSpace::Linear) {
+		colorSpace = space;
+		levels.clear();
+		bias = 0.5f * std::log2(float(image.getWidth() * image.getHeight()));
+
+		Image<RGBA32F> colors(image.getWidth(), image.getHeight());
+		Level		  &first = levels.emplace_back(image.getWidth(), image.getHeight());
+		for (std::size_t y = 0; y < image.getHeight(); ++y) {
+			for (std::size_t x = 0; x < image.getWidth(); ++x) {
+				if constexpr (std::is_same_v<ColorFormat, RGBA>) {
+					first(x, y) = image(x, y);
+					_mm_storeu_ps(colors(x, y).data, decodeTexel(image(x, y), colorSpace));
+				} else {
+					colors(x, y) = convert<ColorFormat, RGBA32F>(image(x, y));
+					first(x, y)	 = encode(_mm_loadu_ps(colors(x, y).data));
+				}
+			}
+		}
+
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		while (colors.getWidth() > 1 || colors.getHeight() > 1) {
+			const std::size_t w = std::max<std::size_t>(colors.getWidth() / 2, 1), h = std::max<std::size_t>(colors.getHeight() / 2, 1);
+			Image<RGBA32F>	  next(w, h);
+			Level			  dst(w, h);
+			auto			  load = [&](std::size_t x, std::size_t y) { return _mm_loadu_ps(colors(x, y).data); };
+			for (std::size_t y = 0; y < h; ++y) {
+				// odd sizes repeat the last row and column
+				const std::size_t y0 = std::min(2 * y, colors.getHeight() - 1), y1 = std::min(2 * y + 1, colors.getHeight() - 1);
+				for (std::size_t x = 0; x < w; ++x) {
+					const std::size_t x0 = std::min(2 * x, colors.getWidth() - 1), x1 = std::min(2 * x + 1, colors.getWidth() - 1);
+					const __m128 mean = _mm_mul_ps(
+						_mm_add_ps(_mm_add_ps(load(x0, y0), load(x1, y0)), _mm_add_ps(load(x0, y1), load(x1, y1))), quarter);
+					_mm_storeu_ps(next(x, y).data, mean);
+					dst(x, y) = encode(mean);
+				}
+			}
+			levels.push_back(std::move(dst));
+			colors = std::move(next);
+		}
+	}
+
+	inline std::size_t levelCount() const { return levels.size(); }
+	inline const Level &level(std::size_t i) const { return levels[i]; }
+	inline std::size_t levelWidth(std::size_t i) const { return levels[i].getWidth(); }
+	inline std::size_t levelHeight(std::size_t i) const { return levels[i].getHeight(); }
+	inline std::size_t getWidth() const { return levels.empty() ? 0 : levels[0].getWidth(); }
+	inline std::size_t getHeight() const { return levels.empty() ? 0 : levels[0].getHeight(); }
+	inline ColorSpace getColorSpace() const { return colorSpace; }
+	inline float lodBias() const { return bias; }
+	inline RGBA texel(std::size_t i, int x, int y) const { return levels[i](std::size_t(x), std::size_t(y)); }
+
+	/// @brief Bytes held by the texels of all levels
+	std::size_t memory() const {
+		std::size_t bytes = 0;
+		for (const auto &level : levels) bytes += level.memory();
+		return bytes;
+	}
+
+	/// @brief Filtered texel at \a uv as an SSE vector, so that it is returned in one register
+	/// @param footprint - width of the area to average in texture coordinates
+	__m128 sampleSSE(vec2 uv, float footprint, TextureFilter filter) const {
+		return texfilter::sample(*this, uv, footprint, filter);
+	}
+
+	inline RGBA32F sample(vec2 uv, float footprint, TextureFilter filter) const {
+		RGBA32F result;
+		_mm_storeu_ps(result.data, sampleSSE(uv, footprint, filter));
+		return result;
+	}
+};
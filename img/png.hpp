@@ -0,0 +1,323 @@
+#pragma once
+
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <img/image.hpp>
+
+/// Settings of exportToFile<export_PNG>, global like stbi_write_png_compression_level of stb_image_write
+struct PngSettings {
+	int		 level	 = 6;	  ///< zlib compression level, 0 stores the rows uncompressed
+	/// threads per image, 0 for one per hardware thread. Few by default, images are usually written while the
+	/// next frame renders on all cores.
+	unsigned threads = 2;
+};
+inline PngSettings pngSettings;
+
+/**
+ * PNG encoder that converts, filters and deflates on several threads.
+ *
+ * Like pigz, the filtered rows are split into strips of about STRIP_BYTES that are deflated independently. Every
+ * strip but the last ends with a sync flush, which byte aligns the raw deflate streams so that they can be
+ * concatenated, and every strip but the first starts with the 32 KiB before it as the dictionary, which keeps the
+ * size close to that of a single stream. The adler32 checksums of the strips are combined for the zlib trailer.
+ * The strips do not depend on the thread count, so neither does the file.
+ */
+class PngWriter {
+	static_assert(sizeof(RGBA32F) == 4 * sizeof(float) && sizeof(RGBA) == 4);
+
+	static constexpr std::size_t STRIP_BYTES = 256 * 1024;
+	static constexpr std::size_t WINDOW		 = 32 * 1024;
+	static constexpr std::size_t BPP		 = 4;
+	static constexpr std::size_t FILTER_ROWS = 64;	   ///< rows filtered by one job
+
+	struct Strip {
+		std::size_t			 begin, end;	 ///< byte range in filtered
+		std::vector<uint8_t> deflated;
+		uLong				 adler;
+	};
+
+	PngSettings			 settings;
+	std::size_t			 width = 0, height = 0;
+	std::vector<uint8_t> pixels;	   ///< 8 bit RGBA rows
+	std::vector<uint8_t> filtered;	   ///< for every row the filter type followed by the filtered bytes
+
+	inline std::size_t rowBytes() const { return width * BPP; }
+
+	/**
+	 * Threads that help the calling thread with every phase of one image, so they are started once per write()
+	 * instead of once per phase. The first exception thrown by a job stops the phase and is rethrown by
+	 * parallelFor() on the calling thread.
+	 */
+	class Workers {
+		using Job = std::function<void(std::size_t)>;
+
+		std::mutex				 mutex;
+		std::condition_variable	 start, done;
+		const Job				*job   = nullptr;	  ///< of the current phase, guarded by mutex like count
+		std::size_t				 count = 0;
+		std::atomic<std::size_t> next  = 0;
+		unsigned				 helpers = 0, finished = 0, generation = 0;
+		bool					 stopping = false;
+		std::exception_ptr		 error;			   ///< the first one thrown in the current phase
+		std::vector<std::thread> threads;
+
+		void work() {
+			for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+				try {
+					(*job)(i);
+				} catch (...) {
+					std::lock_guard lock(mutex);
+					if (!error) error = std::current_exception();
+					// no more indices are handed out, the jobs already taken still finish
+					next.store(count, std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void loop() {
+			unsigned		 seen = 0;
+			std::unique_lock lock(mutex);
+			while (true) {
+				start.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping) return;
+				seen = generation;
+				lock.unlock();
+				work();
+				lock.lock();
+				// every helper takes part in every phase, so none of them can still be in work() for the next one
+				if (++finished == helpers) done.notify_one();
+			}
+		}
+
+	   public:
+		/// @param threadCount - including the calling thread, 0 for one per hardware thread
+		explicit Workers(unsigned threadCount) {
+			if (threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+			helpers = threadCount - 1;
+			threads.reserve(helpers);
+			for (unsigned t = 0; t < helpers; ++t) threads.emplace_back(&Workers::loop, this);
+		}
+
+		Workers(const Workers &)			= delete;
+		Workers &operator=(const Workers &) = delete;
+
+		~Workers() {
+			{
+				std::lock_guard lock(mutex);
+				stopping = true;
+			}
+			start.notify_all();
+			for (auto &thread : threads) thread.join();
+		}
+
+		/// @brief Calls \a func(i) for i in [0, n) on the workers and the calling thread
+		/// @throws the first exception thrown by \a func, after all workers stopped
+		void parallelFor(std::size_t n, const Job &func) {
+			{
+				std::lock_guard lock(mutex);
+				job		 = &func;
+				count	 = n;
+				finished = 0;
+				next.store(0, std::memory_order_relaxed);
+				++generation;
+			}
+			start.notify_all();
+			work();
+			std::unique_lock lock(mutex);
+			done.wait(lock, [&]() { return finished == helpers; });
+			if (error) std::rethrow_exception(std::exchange(error, nullptr));
+		}
+	};
+
+	static inline uint8_t paeth(int a, int b, int c) {
+		int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return a;
+		return pb <= pc ? b : c;
+	}
+
+	/// @brief Applies PNG filter \a type to row \a y, the bytes above the first row count as 0
+	void applyFilter(std::size_t y, int type, uint8_t *out) const {
+		const std::size_t n	  = rowBytes();
+		const uint8_t	 *row = pixels.data() + y * n;
+		// the row above the first one is all zeros, which turns Up into None and Paeth into Sub
+		if (y == 0 && type == 2) type = 0;
+		if (y == 0 && type == 4) type = 1;
+		const uint8_t *up = y > 0 ? row - n : nullptr;
+
+		// the first pixel has no left neighbour, the separate loops let the compiler vectorize the rest
+		switch (type) {
+			case 0: std::copy_n(row, n, out); break;
+			case 1:
+				std::copy_n(row, BPP, out);
+				for (std::size_t i = BPP; i < n; ++i) out[i] = row[i] - row[i - BPP];
+				break;
+			case 2:
+				for (std::size_t i = 0; i < n; ++i) out[i] = row[i] - up[i];
+				break;
+			case 3:
+				if (!up) {
+					std::copy_n(row, BPP, out);
+					for (std::size_t i = BPP; i < n; ++i) out[i] = row[i] - (row[i - BPP] >> 1);
+					break;
+				}
+				for (std::size_t i = 0; i < BPP; ++i) out[i] = row[i] - (up[i] >> 1);
+				for (std::size_t i = BPP; i < n; ++i) out[i] = row[i] - ((row[i - BPP] + up[i]) >> 1);
+				break;
+			default:
+				for (std::size_t i = 0; i < BPP; ++i) out[i] = row[i] - up[i];
+				for (std::size_t i = BPP; i < n; ++i) out[i] = row[i] - paeth(row[i - BPP], up[i], up[i - BPP]);
+				break;
+		}
+	}
+
+	/// @brief Picks the filter with the smallest sum of absolute signed bytes, the heuristic stb_image_write uses
+	/// @param candidate - rowBytes() bytes to try the filters in
+	void filterRow(std::size_t y, std::vector<uint8_t> &candidate) {
+		uint8_t *out = filtered.data() + y * (rowBytes() + 1);
+		int		 best = 0;
+		if (settings.level > 0) {
+			long bestCost = std::numeric_limits<long>::max();
+			for (int type = 0; type < 5; ++type) {
+				applyFilter(y, type, candidate.data());
+				long cost = 0;
+				for (uint8_t v : candidate) cost += std::abs(int(int8_t(v)));
+				if (cost < bestCost) {
+					bestCost = cost;
+					best	 = type;
+				}
+			}
+		}
+		out[0] = uint8_t(best);
+		applyFilter(y, best, out + 1);
+	}
+
+	void deflateStrip(Strip &strip, bool last) const {
+		z_stream z{};
+		// negative window bits produce a raw deflate stream, the zlib header and trailer are written by encode()
+		if (deflateInit2(&z, settings.level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw std::runtime_error("Failed to initialize deflate");
+		}
+		if (strip.begin > 0) {
+			const std::size_t dictionary = strip.begin - std::min(strip.begin, WINDOW);
+			deflateSetDictionary(&z, filtered.data() + dictionary, uInt(strip.begin - dictionary));
+		}
+
+		const std::size_t size = strip.end - strip.begin;
+		strip.adler			   = adler32(1, filtered.data() + strip.begin, uInt(size));
+		strip.deflated.resize(deflateBound(&z, size) + 16);
+		z.next_in	= const_cast<Bytef *>(filtered.data() + strip.begin);
+		z.avail_in	= uInt(size);
+		z.next_out	= strip.deflated.data();
+		z.avail_out = uInt(strip.deflated.size());
+
+		const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+		for (;;) {
+			const int ret = deflate(&z, flush);
+			if (ret == Z_STREAM_ERROR) throw std::runtime_error("Failed to deflate PNG strip");
+			if (last ? ret == Z_STREAM_END : z.avail_out > 0) break;
+			// out of space, deflate has to be called again with the same flush
+			const std::size_t used = strip.deflated.size() - z.avail_out;
+			strip.deflated.resize(strip.deflated.size() * 2);
+			z.next_out	= strip.deflated.data() + used;
+			z.avail_out = uInt(strip.deflated.size() - used);
+		}
+		strip.deflated.resize(strip.deflated.size() - z.avail_out);
+		deflateEnd(&z);
+	}
+
+	static void putBE(std::ostream &out, uint32_t value) {
+		const char bytes[4] = {char(value >> 24), char(value >> 16), char(value >> 8), char(value)};
+		out.write(bytes, 4);
+	}
+
+	static void chunk(std::ostream &out, const char *type, const uint8_t *data, std::size_t size) {
+		putBE(out, uint32_t(size));
+		out.write(type, 4);
+		out.write(reinterpret_cast<const char *>(data), size);
+		uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+		// crc32 returns the initial value for a null pointer
+		if (size > 0) crc = crc32(crc, data, uInt(size));
+		putBE(out, uint32_t(crc));
+	}
+
+	/// @brief Filters and deflates the rows in pixels and writes the file
+	void encode(std::ostream &out, Workers &workers) {
+		if (width == 0 || height == 0) throw std::runtime_error("Cannot write an empty PNG");
+		filtered.resize(height * (rowBytes() + 1));
+		workers.parallelFor((height + FILTER_ROWS - 1) / FILTER_ROWS, [&](std::size_t block) {
+			std::vector<uint8_t> candidate(rowBytes());
+			for (std::size_t y = block * FILTER_ROWS; y < std::min((block + 1) * FILTER_ROWS, height); ++y) {
+				filterRow(y, candidate);
+			}
+		});
+
+		const std::size_t  stripRows = std::max<std::size_t>(1, STRIP_BYTES / (rowBytes() + 1));
+		std::vector<Strip> strips;
+		for (std::size_t y = 0; y < height; y += stripRows) {
+			strips.push_back(Strip{y * (rowBytes() + 1), std::min(y + stripRows, height) * (rowBytes() + 1), {}, 0});
+		}
+		workers.parallelFor(strips.size(), [&](std::size_t i) { deflateStrip(strips[i], i + 1 == strips.size()); });
+
+		static constexpr uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+		out.write(reinterpret_cast<const char *>(SIGNATURE), sizeof(SIGNATURE));
+
+		uint8_t header[13] = {};
+		for (int i = 0; i < 4; ++i) {
+			header[i]	  = uint8_t(width >> (24 - 8 * i));
+			header[i + 4] = uint8_t(height >> (24 - 8 * i));
+		}
+		header[8] = 8;	   // bits per channel
+		header[9] = 6;	   // RGBA
+		chunk(out, "IHDR", header, sizeof(header));
+
+		// zlib header with a 32 KiB window and the level hint, followed by one IDAT chunk per strip
+		const int	  levelHint = settings.level < 2 ? 0 : settings.level < 6 ? 1 : settings.level == 6 ? 2 : 3;
+		const uint8_t cmf = 0x78, flg = uint8_t(levelHint << 6);
+		strips.front().deflated.insert(strips.front().deflated.begin(), {cmf, uint8_t(flg + 31 - (cmf * 256 + flg) % 31)});
+
+		uLong adler = adler32(0, nullptr, 0);
+		for (const auto &strip : strips) adler = adler32_combine(adler, strip.adler, z_off_t(strip.end - strip.begin));
+		for (int i = 3; i >= 0; --i) strips.back().deflated.push_back(uint8_t(adler >> (8 * i)));
+
+		for (const auto &strip : strips) chunk(out, "IDAT", strip.deflated.data(), strip.deflated.size());
+		chunk(out, "IEND", nullptr, 0);
+	}
+
+   public:
+	explicit PngWriter(const PngSettings &settings = pngSettings) : settings(settings) {
+		this->settings.level = std::clamp(settings.level, 0, 9);
+	}
+
+	void write(const Image<RGBA32F> &img, std::ostream &out) {
+		width  = img.getWidth();
+		height = img.getHeight();
+		pixels.resize(height * rowBytes());
+		Workers workers(settings.threads);
+		workers.parallelFor(height, [&](std::size_t y) {
+			convertRow(&img(0, y), reinterpret_cast<RGBA *>(pixels.data() + y * rowBytes()), width);
+		});
+		encode(out, workers);
+	}
+
+	void write(const Image<RGBA> &img, std::ostream &out) {
+		width  = img.getWidth();
+		height = img.getHeight();
+		pixels.assign(img.data()->data, img.data()->data + img.size() * BPP);
+		Workers workers(settings.threads);
+		encode(out, workers);
+	}
+};
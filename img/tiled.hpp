@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/**
+ * An image stored in TILE_SIZE x TILE_SIZE tiles, each starting on a cache line and row major inside. Lookups close
+ * to each other in both directions, like the 4 texels of a bilinear sample, usually fall into the same tile and
+ * cache lines, where row major images need a line per row. The edge tiles are padded to the full tile size.
+ */
+template <class Texel, std::size_t TILE_SIZE = 8>
+class TiledImage {
+	static constexpr std::size_t TILE_TEXELS = TILE_SIZE * TILE_SIZE;
+
+	struct alignas(64) Tile {
+		std::array<Texel, TILE_TEXELS> texels;
+	};
+
+	std::vector<Tile> tiles;
+	std::size_t		  width	 = 0;
+	std::size_t		  height = 0;
+	std::size_t		  tilesX = 0;
+
+	inline Tile &tile(std::size_t x, std::size_t y) { return tiles[(y / TILE_SIZE) * tilesX + x / TILE_SIZE]; }
+	inline const Tile &tile(std::size_t x, std::size_t y) const {
+		return tiles[(y / TILE_SIZE) * tilesX + x / TILE_SIZE];
+	}
+	static inline std::size_t inTile(std::size_t x, std::size_t y) {
+		return (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+	}
+
+   public:
+	TiledImage() = default;
+	TiledImage(std::size_t width, std::size_t height) { resize(width, height); }
+
+	void resize(std::size_t w, std::size_t h) {
+		width  = w;
+		height = h;
+		tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+		tiles.assign(tilesX * ((h + TILE_SIZE - 1) / TILE_SIZE), Tile{});
+	}
+
+	/// @brief Sets every texel to Texel{}
+	void clear() { std::fill(tiles.begin(), tiles.end(), Tile{}); }
+
+	inline Texel &operator()(std::size_t x, std::size_t y) { return tile(x, y).texels[inTile(x, y)]; }
+	inline const Texel &operator()(std::size_t x, std::size_t y) const { return tile(x, y).texels[inTile(x, y)]; }
+
+	inline std::size_t getWidth() const { return width; }
+	inline std::size_t getHeight() const { return height; }
+
+	/// @brief Bytes held by the texels, padding included
+	inline std::size_t memory() const { return tiles.size() * sizeof(Tile); }
+
+	/// @brief Writes the tiles as they are, read() restores them into an image of the same size
+	void write(std::ostream &out) const { out.write(reinterpret_cast<const char *>(tiles.data()), memory()); }
+
+	void read(std::istream &in) { in.read(reinterpret_cast<char *>(tiles.data()), memory()); }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <img/image.hpp>
+
+enum class VideoFormat { Y4M, RGB };
+
+inline VideoFormat videoFormatFromString(std::string_view name) {
+	if (name == "y4m") return VideoFormat::Y4M;
+	if (name == "rgb") return VideoFormat::RGB;
+	throw std::runtime_error("Unknown video format: " + std::string(name));
+}
+
+/**
+ * Writes frames as an uncompressed video stream to a file, a named pipe or stdout, so that an encoder like ffmpeg
+ * can read them without any intermediate images.
+ *
+ * YUV4MPEG2 streams are 4:2:0 with BT.709 coefficients and limited range, which ffmpeg reads without further
+ * options. Raw streams are packed rgb24 without a header and need
+ * `-f rawvideo -pix_fmt rgb24 -video_size WxH -framerate FPS` on the ffmpeg side. Colors are clamped to [0, 1]
+ * like for PNG output.
+ */
+class VideoWriter {
+	static constexpr float KR = 0.2126f, KB = 0.0722f, KG = 1.f - KR - KB;
+
+	std::ofstream		 file;
+	std::ostream		*out;
+	VideoFormat			 format;
+	int					 fps;
+	std::size_t			 width = 0, height = 0;
+	std::vector<uint8_t> frame;		///< the converted frame
+	std::vector<float>	 chroma;	///< Cb and Cr of two rows at full resolution
+
+	/// @brief Writes the 8 bit luma of \a count pixels to \a luma and the chroma in [-0.5, 0.5] to \a cb and \a cr
+	static void toYCbCr(const RGBA32F *src, std::size_t count, uint8_t *luma, float *cb, float *cr) {
+		const __m256  zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f);
+		const __m256  kr = _mm256_set1_ps(KR), kg = _mm256_set1_ps(KG), kb = _mm256_set1_ps(KB);
+		const __m256  cbScale = _mm256_set1_ps(0.5f / (1.f - KB)), crScale = _mm256_set1_ps(0.5f / (1.f - KR));
+		// limited range luma is 16 to 235, the extra 0.5 rounds when truncating
+		const __m256  yScale = _mm256_set1_ps(219.f), yOffset = _mm256_set1_ps(16.5f);
+		const __m256i order	 = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		auto		  load	 = [&](const float *p) { return _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(p), zero), one); };
+
+		std::size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			const float *p = src[i].data;
+			// transpose 8 RGBA pixels into one vector per channel, the pixels end up in the order 0 2 4 6 1 3 5 7
+			__m256 a = load(p), b = load(p + 8), c = load(p + 16), d = load(p + 24);
+			__m256 t0 = _mm256_unpacklo_ps(a, b), t1 = _mm256_unpackhi_ps(a, b);
+			__m256 t2 = _mm256_unpacklo_ps(c, d), t3 = _mm256_unpackhi_ps(c, d);
+			__m256 r  = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+			__m256 g  = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+			__m256 bl = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+
+			__m256 y = _mm256_fmadd_ps(kr, r, _mm256_fmadd_ps(kg, g, _mm256_mul_ps(kb, bl)));
+			_mm256_storeu_ps(cb + i, _mm256_permutevar8x32_ps(_mm256_mul_ps(_mm256_sub_ps(bl, y), cbScale), order));
+			_mm256_storeu_ps(cr + i, _mm256_permutevar8x32_ps(_mm256_mul_ps(_mm256_sub_ps(r, y), crScale), order));
+
+			__m256i y8 = _mm256_cvttps_epi32(_mm256_fmadd_ps(y, yScale, yOffset));
+			y8		   = _mm256_permutevar8x32_epi32(y8, order);
+			y8		   = _mm256_packus_epi32(y8, y8);
+			y8		   = _mm256_packus_epi16(y8, y8);
+			// pixels 0 to 3 are in the low and 4 to 7 in the high lane
+			const uint32_t lo = _mm256_cvtsi256_si32(y8), hi = _mm256_extract_epi32(y8, 4);
+			std::memcpy(luma + i, &lo, 4);
+			std::memcpy(luma + i + 4, &hi, 4);
+		}
+		for (; i < count; ++i) {
+			const auto	c = clamp(src[i], 0.f, 1.f);
+			const float y = KR * c.x + KG * c.y + KB * c.z;
+			luma[i]		  = uint8_t(y * 219.f + 16.5f);
+			cb[i]		  = (c.z - y) * 0.5f / (1.f - KB);
+			cr[i]		  = (c.x - y) * 0.5f / (1.f - KR);
+		}
+	}
+
+	void convertY4M(const Image<RGBA32F> &img) {
+		const std::size_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+		frame.resize(width * height + 2 * cw * ch);
+		chroma.resize(4 * width);
+		uint8_t *u = frame.data() + width * height, *v = u + cw * ch;
+		float	*cb0 = chroma.data(), *cr0 = cb0 + width, *cb1 = cr0 + width, *cr1 = cb1 + width;
+
+		for (std::size_t cy = 0; cy < ch; ++cy) {
+			const std::size_t y0 = 2 * cy, y1 = std::min(y0 + 1, height - 1);
+			toYCbCr(&img(0, y0), width, frame.data() + y0 * width, cb0, cr0);
+			if (y1 != y0) toYCbCr(&img(0, y1), width, frame.data() + y1 * width, cb1, cr1);
+			else std::copy_n(cb0, 2 * width, cb1);
+
+			// every chroma sample is the average of 2x2 pixels, centered between them as C420jpeg says
+			for (std::size_t cx = 0; cx < cw; ++cx) {
+				const std::size_t x0 = 2 * cx, x1 = std::min(x0 + 1, width - 1);
+				const float		  b	 = (cb0[x0] + cb0[x1] + cb1[x0] + cb1[x1]) * 0.25f;
+				const float		  r	 = (cr0[x0] + cr0[x1] + cr1[x0] + cr1[x1]) * 0.25f;
+				u[cy * cw + cx]		 = uint8_t(b * 224.f + 128.5f);
+				v[cy * cw + cx]		 = uint8_t(r * 224.f + 128.5f);
+			}
+		}
+	}
+
+	void convertRGB(const Image<RGBA32F> &img) {
+		frame.resize(width * height * 3);
+		std::vector<RGBA> row(width);
+		for (std::size_t y = 0; y < height; ++y) {
+			convertRow(&img(0, y), row.data(), width);
+			uint8_t *dst = frame.data() + y * width * 3;
+			for (std::size_t x = 0; x < width; ++x) std::copy_n(row[x].data, 3, dst + x * 3);
+		}
+	}
+
+   public:
+	/**
+	 * @param path - file or named pipe, "-" for stdout. Opening a named pipe waits for its reader.
+	 * @param fps - frame rate written to the YUV4MPEG2 header
+	 */
+	VideoWriter(const std::string &path, VideoFormat format, int fps) : out(&std::cout), format(format), fps(fps) {
+		if (path != "-") {
+			file.open(path, std::ios::binary);
+			if (!file) { throw std::runtime_error("Failed to open video stream: " + path); }
+			out = &file;
+		}
+	}
+
+	VideoWriter(const VideoWriter &)			= delete;
+	VideoWriter &operator=(const VideoWriter &) = delete;
+
+	/// @brief Appends \a img to the stream, every frame has to have the size of the first one
+	void write(const Image<RGBA32F> &img) {
+		if (width == 0) {
+			width  = img.getWidth();
+			height = img.getHeight();
+			if (format == VideoFormat::Y4M) {
+				*out << std::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", width, height, fps);
+			}
+		} else if (img.getWidth() != width || img.getHeight() != height) {
+			throw std::runtime_error("Video frames must all have the same size");
+		}
+
+		if (format == VideoFormat::Y4M) {
+			convertY4M(img);
+			*out << "FRAME\n";
+		} else {
+			convertRGB(img);
+		}
+		out->write(reinterpret_cast<const char *>(frame.data()), frame.size());
+		out->flush();
+		if (!*out) { throw std::runtime_error("Failed to write to the video stream"); }
+	}
+};
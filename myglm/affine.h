@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdexcept>
+#include <myglm/mat.h>
+#include <myglm/simd.h>
+#include "util/utils.hpp"
+
+/**
+ * Affine transform of points and vectors: a 3x3 linear part and a translation, without the projective row of a mat4.
+ * Stored as four vec3a columns, so that transforming a point is three multiply-adds of broadcast coordinates and
+ * needs no horizontal sums.
+ */
+class affine3 {
+   public:
+	vec3a columns[4];	  ///< images of the x, y and z axis, then the translation
+
+	/// identity
+	inline affine3()
+		: columns{vec3a(1.f, 0.f, 0.f), vec3a(0.f, 1.f, 0.f), vec3a(0.f, 0.f, 1.f), vec3a(0.f, 0.f, 0.f)} {}
+
+	/// the upper three rows of \a m, its last row is taken to be (0, 0, 0, 1)
+	inline explicit affine3(const mat4 &m) {
+		for (std::size_t j = 0; j < 4; ++j) columns[j] = vec3a(m[0][j], m[1][j], m[2][j]);
+	}
+
+	inline vec3 transformPoint(const vec3 &p) const {
+		return vec3(columns[0] * p.x + columns[1] * p.y + columns[2] * p.z + columns[3]);
+	}
+
+	inline vec3 transformVector(const vec3 &v) const {
+		return vec3(columns[0] * v.x + columns[1] * v.y + columns[2] * v.z);
+	}
+
+	/// @brief The inverse transform, throws like invert() if the linear part is singular
+	inline affine3 inverse() const {
+		const vec3a &a = columns[0], &b = columns[1], &c = columns[2];
+		// the rows of the inverse linear part are the cross products of its columns over the determinant
+		const vec3a r0 = cross(b, c), r1 = cross(c, a), r2 = cross(a, b);
+		const float det = dot(a, r0);
+		if (det == 0) {
+			dbLog(dbg::LOG_ERROR, "Affine transform inversion failed, determinant is zero.");
+			throw std::runtime_error("cannot invert affine transform, determinant is zero");
+		}
+
+		affine3		 result;
+		const vec3a &t = columns[3];
+		for (std::size_t j = 0; j < 3; ++j) result.columns[j] = vec3a(r0[j], r1[j], r2[j]) / det;
+		result.columns[3] = -vec3a(dot(r0, t), dot(r1, t), dot(r2, t)) / det;
+		return result;
+	}
+};
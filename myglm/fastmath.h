@@ -0,0 +1,278 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <myglm/packet.h>
+#include <myglm/simd.h>
+#include <myglm/vec.h>
+
+/*
+ * Approximate transcendentals for shading. Every function exists for float and, with AVX2, for float8, computed by
+ * the same branch free kernels: range reduction followed by a minimax polynomial (the Cephes single precision
+ * coefficients). Loops over the float versions vectorize as well.
+ *
+ * Error bounds, as measured by the tests in test.cpp (the std functions are within about 6e-8):
+ *  - rsqrt:		relative error below 3e-7 for normal x > 0 (the hardware estimate plus one Newton step)
+ *  - sin, cos:		absolute error below 1e-7 for |x| <= 8192, precision degrades for larger |x|
+ *  - exp:			relative error below 1e-7 for x in [-87, 88], 0 below -87.3 and +inf above 88.7
+ *  - exp2:			relative error below 1e-7 for x in [-126, 127], 0 below -126 and +inf above 127
+ *  - log2:			error below 1e-7 * max(1, |log2(x)|) for normal finite x > 0, -inf for 0 and NaN for x < 0
+ *  - pow:			relative error below 1e-7 * (1 + |y * log2(x)|) for x > 0, pow(0, y > 0) = 0 and pow(x, 0) = 1 for
+ *					any x like std::pow, unlike std::pow NaN for x < 0 (also for integer y) and for pow(1, +-inf)
+ *
+ * Define MYGLM_PRECISE_MATH to compute all of them with the std functions instead, e.g. to tell approximation
+ * error apart from other differences in an image.
+ */
+
+namespace fast {
+namespace detail {
+/// rounds to the nearest integer (ties to even) for |x| < 2^22, cheaper than std::nearbyint and the same for float8
+template <class T>
+inline T roundInt(T x) {
+	const T magic = 12582912.f;		// 1.5 * 2^23
+	return (x + magic) - magic;
+}
+
+/// blends the bits, a conditional on floats would keep GCC from vectorizing loops over the float functions
+inline float select(bool mask, float a, float b) {
+	const int32_t bits = -int32_t(mask);
+	return std::bit_cast<float>((std::bit_cast<int32_t>(a) & bits) | (std::bit_cast<int32_t>(b) & ~bits));
+}
+inline float clamp(float x, float lo, float hi) { return select(x < lo, lo, select(x > hi, hi, x)); }
+
+/// 2^n for integer valued n in [-126, 127]
+inline float pow2(float n) { return std::bit_cast<float>((int32_t(n) + 127) << 23); }
+
+/// x = m * 2^e with m in [sqrt(0.5), sqrt(2)), for normal x > 0
+inline float split(float x, float &e) {
+	const int32_t bits = std::bit_cast<int32_t>(x);
+	// the exponent of x / sqrt(0.5), so that the mantissa is centered around 1
+	const int32_t exponent = ((bits - 0x3f3504f3) >> 23);
+	e					   = float(exponent);
+	return std::bit_cast<float>(bits - (exponent << 23));
+}
+
+#ifdef MYGLM_PACKET
+inline float8 pow2(float8 n) {
+	return float8(_mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n.m), _mm256_set1_epi32(127)), 23)));
+}
+
+inline float8 split(float8 x, float8 &e) {
+	const __m256i bits	   = _mm256_castps_si256(x.m);
+	const __m256i exponent = _mm256_srai_epi32(_mm256_sub_epi32(bits, _mm256_set1_epi32(0x3f3504f3)), 23);
+	e					   = float8(_mm256_cvtepi32_ps(exponent));
+	return float8(_mm256_castsi256_ps(_mm256_sub_epi32(bits, _mm256_slli_epi32(exponent, 23))));
+}
+
+inline float8 perLane(float8 x, float (*func)(float)) {
+	for (std::size_t i = 0; i < float8::LANES; ++i) x[i] = func(x[i]);
+	return x;
+}
+#endif
+
+/// sin(r) for |r| <= pi / 4
+template <class T>
+inline T sinPoly(T r) {
+	const T r2 = r * r;
+	return r + r * r2 * ((T(-1.9515295891e-4f) * r2 + T(8.3321608736e-3f)) * r2 + T(-1.6666654611e-1f));
+}
+
+/// cos(r) for |r| <= pi / 4
+template <class T>
+inline T cosPoly(T r) {
+	const T r2 = r * r;
+	return T(1.f) - T(0.5f) * r2 +
+		   r2 * r2 * ((T(2.443315711809948e-5f) * r2 + T(-1.388731625493765e-3f)) * r2 + T(4.166664568298827e-2f));
+}
+
+/**
+ * x - q * pi / 2 with the quadrant q in {0, 1, 2, 3}. pi / 2 is subtracted in three parts (Cody and Waite), the
+ * first of which has few enough bits that q * part is exact.
+ */
+template <class T>
+inline T reduce(T x, T &quadrant) {
+	const T q = roundInt(x * T(0.63661977236f));
+	T		r = x - q * T(1.5703125f);
+	r		  = r - q * T(4.837512969970703125e-4f);
+	r		  = r - q * T(7.54978995489188216e-8f);
+	quadrant  = q - T(4.f) * roundInt(q * T(0.25f) - T(0.375f));
+	return r;
+}
+
+template <class T>
+inline void sincos(T x, T &s, T &c) {
+	T		quadrant;
+	const T r = reduce(x, quadrant), sr = sinPoly(r), cr = cosPoly(r);
+	// sin(x) is sin r, cos r, -sin r, -cos r and cos(x) cos r, -sin r, -cos r, sin r in the four quadrants
+	const auto odd = (quadrant == T(1.f)) | (quadrant == T(3.f));
+	s			   = select(odd, cr, sr);
+	c			   = select(odd, sr, cr);
+	s			   = select(quadrant >= T(2.f), -s, s);
+	c			   = select((quadrant == T(1.f)) | (quadrant == T(2.f)), -c, c);
+}
+
+/// e^r for |r| <= ln(2) / 2
+template <class T>
+inline T expPoly(T r) {
+	T p = T(1.9875691500e-4f);
+	p	= p * r + T(1.3981999507e-3f);
+	p	= p * r + T(8.3334519073e-3f);
+	p	= p * r + T(4.1665795894e-2f);
+	p	= p * r + T(1.6666665459e-1f);
+	p	= p * r + T(5.0000001201e-1f);
+	return p * r * r + r + T(1.f);
+}
+
+template <class T>
+inline T exp(T x) {
+	const T clamped = clamp(x, T(-87.3f), T(88.7f));
+	const T n		= roundInt(clamped * T(1.44269504089f));
+	// x - n * ln(2) in two parts
+	const T r = clamped - n * T(0.693359375f) + n * T(2.12194440e-4f);
+	// 2^128 is not a float, so 2^n is applied in two halves
+	const T low	   = roundInt(n * T(0.5f) - T(0.25f));
+	const T result = expPoly(r) * pow2(low) * pow2(n - low);
+	return select(x < T(-87.3f), T(0.f), select(x > T(88.7f), T(INFINITY), result));
+}
+
+template <class T>
+inline T exp2(T x) {
+	const T clamped = clamp(x, T(-126.f), T(127.f));
+	const T n		= roundInt(clamped);
+	const T result	= expPoly((clamped - n) * T(0.69314718056f)) * pow2(n);
+	return select(x < T(-126.f), T(0.f), select(x > T(127.f), T(INFINITY), result));
+}
+
+template <class T>
+inline T log2(T x) {
+	T		e;
+	const T m = split(x, e) - T(1.f), m2 = m * m;
+	T		p = T(7.0376836292e-2f);
+	p		  = p * m + T(-1.1514610310e-1f);
+	p		  = p * m + T(1.1676998740e-1f);
+	p		  = p * m + T(-1.2420140846e-1f);
+	p		  = p * m + T(1.4249322787e-1f);
+	p		  = p * m + T(-1.6668057665e-1f);
+	p		  = p * m + T(2.0000714765e-1f);
+	p		  = p * m + T(-2.4999993993e-1f);
+	p		  = p * m + T(3.3333331174e-1f);
+	// ln(1 + m) = m - m^2 / 2 + m^3 p(m)
+	const T ln = m - T(0.5f) * m2 + m * m2 * p;
+	const T result = ln * T(1.44269504089f) + e;
+	return select(x > T(0.f), result, select(x == T(0.f), T(-INFINITY), T(NAN)));
+}
+}	  // namespace detail
+
+#ifdef MYGLM_PRECISE_MATH
+inline float sin(float x) { return std::sin(x); }
+inline float cos(float x) { return std::cos(x); }
+inline float exp(float x) { return std::exp(x); }
+inline float exp2(float x) { return std::exp2(x); }
+inline float log2(float x) { return std::log2(x); }
+inline float pow(float x, float y) { return std::pow(x, y); }
+inline float rsqrt(float x) { return 1.f / std::sqrt(x); }
+inline void	 sincos(float x, float &s, float &c) {
+	 s = std::sin(x);
+	 c = std::cos(x);
+}
+#else
+inline float sin(float x) {
+	float s, c;
+	detail::sincos(x, s, c);
+	return s;
+}
+inline float cos(float x) {
+	float s, c;
+	detail::sincos(x, s, c);
+	return c;
+}
+inline void	 sincos(float x, float &s, float &c) { detail::sincos(x, s, c); }
+inline float exp(float x) { return detail::exp(x); }
+inline float exp2(float x) { return detail::exp2(x); }
+inline float log2(float x) { return detail::log2(x); }
+
+inline float pow(float x, float y) {
+	// y * log2(x) is NaN for y = 0 and x = 0 or inf
+	const float p = detail::select((x == 0.f) & (y > 0.f), 0.f, detail::exp2(y * detail::log2(x)));
+	return detail::select(y == 0.f, 1.f, p);
+}
+
+inline float rsqrt(float x) {
+#ifdef MYGLM_SIMD
+	const float r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+	// one Newton step on the 12 bit estimate
+	return r * (1.5f - 0.5f * x * r * r);
+#else
+	return 1.f / std::sqrt(x);
+#endif
+}
+#endif
+
+#ifdef MYGLM_PACKET
+#ifdef MYGLM_PRECISE_MATH
+inline float8 sin(float8 x) { return detail::perLane(x, [](float v) { return std::sin(v); }); }
+inline float8 cos(float8 x) { return detail::perLane(x, [](float v) { return std::cos(v); }); }
+inline float8 exp(float8 x) { return detail::perLane(x, [](float v) { return std::exp(v); }); }
+inline float8 exp2(float8 x) { return detail::perLane(x, [](float v) { return std::exp2(v); }); }
+inline float8 log2(float8 x) { return detail::perLane(x, [](float v) { return std::log2(v); }); }
+inline float8 rsqrt(float8 x) { return float8(1.f) / ::sqrt(x); }
+inline void	  sincos(float8 x, float8 &s, float8 &c) {
+	  s = sin(x);
+	  c = cos(x);
+}
+inline float8 pow(float8 x, float8 y) {
+	for (std::size_t i = 0; i < float8::LANES; ++i) x[i] = std::pow(x[i], y[i]);
+	return x;
+}
+#else
+inline float8 sin(float8 x) {
+	float8 s, c;
+	detail::sincos(x, s, c);
+	return s;
+}
+inline float8 cos(float8 x) {
+	float8 s, c;
+	detail::sincos(x, s, c);
+	return c;
+}
+inline void	  sincos(float8 x, float8 &s, float8 &c) { detail::sincos(x, s, c); }
+inline float8 exp(float8 x) { return detail::exp(x); }
+inline float8 exp2(float8 x) { return detail::exp2(x); }
+inline float8 log2(float8 x) { return detail::log2(x); }
+
+inline float8 pow(float8 x, float8 y) {
+	const float8 p = select((x == 0.f) & (y > 0.f), float8(0.f), detail::exp2(y * detail::log2(x)));
+	return select(y == 0.f, float8(1.f), p);
+}
+
+inline float8 rsqrt(float8 x) {
+	const float8 r(_mm256_rsqrt_ps(x.m));
+	return r * (float8(1.5f) - float8(0.5f) * x * r * r);
+}
+#endif
+#endif
+
+/// x^N by repeated squaring, exact up to the rounding of the products
+template <unsigned N, class T>
+inline constexpr T pown(T x) {
+	if constexpr (N == 0) return T(1.f);
+	else if constexpr (N == 1) return x;
+	else {
+		const T half = pown<N / 2>(x);
+		if constexpr (N % 2) return half * half * x;
+		else return half * half;
+	}
+}
+
+template <class T, std::size_t N>
+inline auto exp(const vec<T, N> &v) {
+	return apply(v, [](const T &x) { return exp(x); });
+}
+
+/// v / length(v) with rsqrt, zero vectors give NaN or inf like normalize()
+template <class T, std::size_t N>
+inline auto normalize(const vec<T, N> &v) {
+	return v * rsqrt(dot(v, v));
+}
+}	  // namespace fast
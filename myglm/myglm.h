@@ -4,6 +4,8 @@
 #include <myglm/vec2.h>
 #include <myglm/vec3.h>
 #include <myglm/vec4.h>
+#include <myglm/simd.h>
+#include <myglm/packet.h>
 #include <myglm/views.h>
 #include "util/utils.hpp"
 
@@ -159,3 +161,58 @@ inline constexpr auto invert(const mat<T, 4, 4> &matrix) {
 }
 
 
+#ifdef MYGLM_SIMD
+/**
+ * SSE inverse by 2x2 blocks: with M = |A B; C D| the blocks of the inverse are formed from adjugates of the 2x2
+ * sub-matrices, which are each one register, and the determinant follows from the same products.
+ */
+inline mat4 invert(const mat4 &matrix) {
+	using simd::shuffle;
+	const __m128 r0 = simd::load(matrix[0]), r1 = simd::load(matrix[1]);
+	const __m128 r2 = simd::load(matrix[2]), r3 = simd::load(matrix[3]);
+
+	// 2x2 matrices as (m00, m01, m10, m11): a * b, adj(a) * b and a * adj(b)
+	auto mul	= [](__m128 a, __m128 b) {
+		   return _mm_add_ps(_mm_mul_ps(a, shuffle<0, 3, 0, 3>(b)), _mm_mul_ps(shuffle<1, 0, 3, 2>(a), shuffle<2, 1, 2, 1>(b)));
+	};
+	auto adjMul = [](__m128 a, __m128 b) {
+		return _mm_sub_ps(_mm_mul_ps(shuffle<3, 3, 0, 0>(a), b), _mm_mul_ps(shuffle<1, 1, 2, 2>(a), shuffle<2, 3, 0, 1>(b)));
+	};
+	auto mulAdj = [](__m128 a, __m128 b) {
+		return _mm_sub_ps(_mm_mul_ps(a, shuffle<3, 0, 3, 0>(b)), _mm_mul_ps(shuffle<1, 0, 3, 2>(a), shuffle<2, 1, 2, 1>(b)));
+	};
+
+	const __m128 A = _mm_movelh_ps(r0, r1), B = _mm_movehl_ps(r1, r0);
+	const __m128 C = _mm_movelh_ps(r2, r3), D = _mm_movehl_ps(r3, r2);
+
+	// (|A|, |B|, |C|, |D|)
+	const __m128 det = _mm_sub_ps(_mm_mul_ps(shuffle<0, 2, 0, 2>(r0, r2), shuffle<1, 3, 1, 3>(r1, r3)),
+								  _mm_mul_ps(shuffle<1, 3, 1, 3>(r0, r2), shuffle<0, 2, 0, 2>(r1, r3)));
+	const __m128 detA = shuffle<0, 0, 0, 0>(det), detB = shuffle<1, 1, 1, 1>(det);
+	const __m128 detC = shuffle<2, 2, 2, 2>(det), detD = shuffle<3, 3, 3, 3>(det);
+
+	const __m128 DC = adjMul(D, C), AB = adjMul(A, B);
+	// adjugates of the blocks of the inverse, which is |X Y; Z W| / |M|
+	const __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), mul(B, DC));
+	const __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), mul(C, AB));
+	const __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), mulAdj(D, AB));
+	const __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), mulAdj(A, DC));
+
+	// |M| = |A| |D| + |B| |C| - tr(adj(A) B adj(D) C)
+	const float detM = _mm_cvtss_f32(_mm_add_ss(_mm_mul_ss(detA, detD), _mm_mul_ss(detB, detC))) -
+					   simd::hsum4(_mm_mul_ps(AB, shuffle<0, 2, 1, 3>(DC)));
+	if (detM == 0) {
+		dbLog(dbg::LOG_ERROR, "Matrix inversion failed, determinant is zero.", matrix);
+		throw std::runtime_error("cannot invert matrix, determinant is zero");
+	}
+
+	// the signs turn the adjugates back into the blocks
+	const __m128 scale = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), _mm_set1_ps(detM));
+	const __m128 x = _mm_mul_ps(X, scale), y = _mm_mul_ps(Y, scale), z = _mm_mul_ps(Z, scale), w = _mm_mul_ps(W, scale);
+	return mat4(simd::store4(shuffle<3, 1, 3, 1>(x, y)), simd::store4(shuffle<2, 0, 2, 0>(x, y)),
+				simd::store4(shuffle<3, 1, 3, 1>(z, w)), simd::store4(shuffle<2, 0, 2, 0>(z, w)));
+}
+#endif
+
+#include <myglm/affine.h>
+#include <myglm/fastmath.h>
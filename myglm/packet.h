@@ -0,0 +1,296 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <myglm/vec2.h>
+#include <myglm/vec3.h>
+#include <myglm/vec4.h>
+
+/*
+ * Packets of 8 lanes for batched math in structure of arrays form. float8 and mask8 behave like float and bool, one
+ * AVX register each, and vec<float8, N> holds 8 vectors with one register per component, so that the generic vec
+ * templates (dot, cross, normalize, reflect, ...) work on 8 vectors at once.
+ *
+ * Branches on a mask8 have to be written with select(), any() and all(). Needs AVX2, define MYGLM_NO_SIMD to leave
+ * the packets out.
+ */
+
+#if defined(__AVX2__) && !defined(MYGLM_NO_SIMD)
+#define MYGLM_PACKET
+
+#include <immintrin.h>
+
+class mask8 {
+   public:
+	__m256 m;
+
+	static constexpr std::size_t LANES = 8;
+
+	inline mask8() = default;
+	inline explicit mask8(__m256 m) : m(m) {}
+	inline mask8(bool b) : m(_mm256_castsi256_ps(_mm256_set1_epi32(b ? -1 : 0))) {}
+
+	/// one bit per lane, lane 0 in the lowest bit
+	inline int	bits() const { return _mm256_movemask_ps(m); }
+	inline bool operator[](std::size_t i) const { return (bits() >> i) & 1; }
+};
+
+inline mask8 operator&(mask8 a, mask8 b) { return mask8(_mm256_and_ps(a.m, b.m)); }
+inline mask8 operator|(mask8 a, mask8 b) { return mask8(_mm256_or_ps(a.m, b.m)); }
+inline mask8 operator^(mask8 a, mask8 b) { return mask8(_mm256_xor_ps(a.m, b.m)); }
+inline mask8 operator!(mask8 a) { return a ^ mask8(true); }
+inline mask8 andnot(mask8 a, mask8 b) { return mask8(_mm256_andnot_ps(b.m, a.m)); }	 ///< a & !b
+inline mask8& operator&=(mask8& a, mask8 b) { return a = a & b; }
+inline mask8& operator|=(mask8& a, mask8 b) { return a = a | b; }
+
+inline bool any(mask8 a) { return !_mm256_testz_ps(a.m, a.m); }
+inline bool all(mask8 a) { return a.bits() == 0xff; }
+inline bool none(mask8 a) { return _mm256_testz_ps(a.m, a.m); }
+inline int	count(mask8 a) { return std::popcount(unsigned(a.bits())); }
+
+class float8 {
+   public:
+	union {
+		__m256 m;
+		float  data[8];
+	};
+
+	static constexpr std::size_t LANES = 8;
+
+	/// uninitialized like float, which keeps float8 usable in the unions of vec3 and vec4
+	inline float8() = default;
+	inline explicit float8(__m256 m) : m(m) {}
+	inline float8(float s) : m(_mm256_set1_ps(s)) {}
+	inline float8(float a, float b, float c, float d, float e, float f, float g, float h)
+		: m(_mm256_setr_ps(a, b, c, d, e, f, g, h)) {}
+
+	static inline float8 load(const float* p) { return float8(_mm256_loadu_ps(p)); }
+	inline void			 store(float* p) const { _mm256_storeu_ps(p, m); }
+
+	inline float&		operator[](std::size_t i) { return data[i]; }
+	inline const float& operator[](std::size_t i) const { return data[i]; }
+};
+
+static_assert(sizeof(float8) == 32 && std::is_trivially_default_constructible_v<float8>);
+
+inline float8 operator+(float8 a, float8 b) { return float8(_mm256_add_ps(a.m, b.m)); }
+inline float8 operator-(float8 a, float8 b) { return float8(_mm256_sub_ps(a.m, b.m)); }
+inline float8 operator*(float8 a, float8 b) { return float8(_mm256_mul_ps(a.m, b.m)); }
+inline float8 operator/(float8 a, float8 b) { return float8(_mm256_div_ps(a.m, b.m)); }
+inline float8 operator-(float8 a) { return float8(_mm256_xor_ps(a.m, _mm256_set1_ps(-0.f))); }
+inline float8& operator+=(float8& a, float8 b) { return a = a + b; }
+inline float8& operator-=(float8& a, float8 b) { return a = a - b; }
+inline float8& operator*=(float8& a, float8 b) { return a = a * b; }
+inline float8& operator/=(float8& a, float8 b) { return a = a / b; }
+
+// ordered comparisons are false for NaN lanes and != is true, like for float
+inline mask8 operator<(float8 a, float8 b) { return mask8(_mm256_cmp_ps(a.m, b.m, _CMP_LT_OQ)); }
+inline mask8 operator<=(float8 a, float8 b) { return mask8(_mm256_cmp_ps(a.m, b.m, _CMP_LE_OQ)); }
+inline mask8 operator>(float8 a, float8 b) { return mask8(_mm256_cmp_ps(a.m, b.m, _CMP_GT_OQ)); }
+inline mask8 operator>=(float8 a, float8 b) { return mask8(_mm256_cmp_ps(a.m, b.m, _CMP_GE_OQ)); }
+inline mask8 operator==(float8 a, float8 b) { return mask8(_mm256_cmp_ps(a.m, b.m, _CMP_EQ_OQ)); }
+inline mask8 operator!=(float8 a, float8 b) { return mask8(_mm256_cmp_ps(a.m, b.m, _CMP_NEQ_UQ)); }
+inline mask8 isnan(float8 a) { return mask8(_mm256_cmp_ps(a.m, a.m, _CMP_UNORD_Q)); }
+
+/// lanes of \a a where \a mask is set, of \a b elsewhere
+inline float8 select(mask8 mask, float8 a, float8 b) { return float8(_mm256_blendv_ps(b.m, a.m, mask.m)); }
+
+/// the operands are swapped so that NaN lanes give the same result as std::min and std::max
+inline float8 min(float8 a, float8 b) { return float8(_mm256_min_ps(b.m, a.m)); }
+inline float8 max(float8 a, float8 b) { return float8(_mm256_max_ps(b.m, a.m)); }
+inline float8 clamp(float8 a, float8 lo, float8 hi) { return min(max(a, lo), hi); }
+inline float8 abs(float8 a) { return float8(_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.m)); }
+inline float8 sqrt(float8 a) { return float8(_mm256_sqrt_ps(a.m)); }
+inline float8 floor(float8 a) { return float8(_mm256_floor_ps(a.m)); }
+
+/// a * b + c, fused if the target has FMA
+inline float8 fmadd(float8 a, float8 b, float8 c) {
+#ifdef __FMA__
+	return float8(_mm256_fmadd_ps(a.m, b.m, c.m));
+#else
+	return a * b + c;
+#endif
+}
+
+inline float hsum(float8 a) {
+	__m128 v = _mm_add_ps(_mm256_castps256_ps128(a.m), _mm256_extractf128_ps(a.m, 1));
+	v		 = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(v, _mm_movehdup_ps(v)));
+}
+
+inline float hmin(float8 a) {
+	__m128 v = _mm_min_ps(_mm256_castps256_ps128(a.m), _mm256_extractf128_ps(a.m, 1));
+	v		 = _mm_min_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_min_ss(v, _mm_movehdup_ps(v)));
+}
+
+inline float hmax(float8 a) {
+	__m128 v = _mm_max_ps(_mm256_castps256_ps128(a.m), _mm256_extractf128_ps(a.m, 1));
+	v		 = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_max_ss(v, _mm_movehdup_ps(v)));
+}
+
+inline std::ostream& operator<<(std::ostream& out, float8 a) {
+	out << "[";
+	for (std::size_t i = 0; i < float8::LANES; ++i) out << (i ? "," : "") << a[i];
+	return out << "]";
+}
+
+inline std::ostream& operator<<(std::ostream& out, mask8 a) {
+	out << "[";
+	for (std::size_t i = 0; i < mask8::LANES; ++i) out << (i ? "," : "") << a[i];
+	return out << "]";
+}
+
+using vec2x8 = vec<float8, 2>;
+using vec3x8 = vec<float8, 3>;
+using vec4x8 = vec<float8, 4>;
+
+// the generic scalar operators take a T, which a float does not deduce to
+template <std::size_t N>
+inline auto operator+(const vec<float8, N>& v, float s) {
+	return v + float8(s);
+}
+
+template <std::size_t N>
+inline auto operator-(const vec<float8, N>& v, float s) {
+	return v - float8(s);
+}
+
+template <std::size_t N>
+inline auto operator*(const vec<float8, N>& v, float s) {
+	return v * float8(s);
+}
+
+template <std::size_t N>
+inline auto operator/(const vec<float8, N>& v, float s) {
+	return v / float8(s);
+}
+
+// overloads of the generic templates whose scalar versions branch on a comparison
+
+template <std::size_t N>
+inline auto min(const vec<float8, N>& v1, const vec<float8, N>& v2) {
+	return apply2(v1, v2, [](float8 a, float8 b) { return min(a, b); });
+}
+
+template <std::size_t N>
+inline auto max(const vec<float8, N>& v1, const vec<float8, N>& v2) {
+	return apply2(v1, v2, [](float8 a, float8 b) { return max(a, b); });
+}
+
+template <std::size_t N>
+inline auto clamp(const vec<float8, N>& v, float8 lo, float8 hi) {
+	return apply(v, [&](float8 a) { return clamp(a, lo, hi); });
+}
+
+/// zero length lanes become NaN like they do for vec3
+template <std::size_t N>
+inline auto normalize(const vec<float8, N>& v) {
+	return v / length(v);
+}
+
+/// lanes where any component differs
+template <std::size_t N>
+inline mask8 operator!=(const vec<float8, N>& u, const vec<float8, N>& v) {
+	return [&]<std::size_t... I>(std::index_sequence<I...>) {
+		return ((u[I] != v[I]) | ...);
+	}(std::make_index_sequence<N>{});
+}
+
+/// lanes where all components are equal
+template <std::size_t N>
+inline mask8 operator==(const vec<float8, N>& u, const vec<float8, N>& v) {
+	return !(u != v);
+}
+
+template <std::size_t N>
+inline vec<float8, N> select(mask8 mask, const vec<float8, N>& a, const vec<float8, N>& b) {
+	return apply2(a, b, [&](float8 x, float8 y) { return select(mask, x, y); });
+}
+
+/// packet with \a v in every lane
+template <std::size_t N>
+inline vec<float8, N> broadcast(const vec<float, N>& v) {
+	vec<float8, N> result;
+	for (std::size_t i = 0; i < N; ++i) result[i] = float8(v[i]);
+	return result;
+}
+
+template <std::size_t N>
+inline vec<float, N> extract(const vec<float8, N>& v, std::size_t lane) {
+	vec<float, N> result;
+	for (std::size_t i = 0; i < N; ++i) result[i] = v[i][lane];
+	return result;
+}
+
+template <std::size_t N>
+inline void insert(vec<float8, N>& v, std::size_t lane, const vec<float, N>& value) {
+	for (std::size_t i = 0; i < N; ++i) v[i][lane] = value[i];
+}
+
+/// sum of the 8 vectors
+template <std::size_t N>
+inline vec<float, N> hsum(const vec<float8, N>& v) {
+	vec<float, N> result;
+	for (std::size_t i = 0; i < N; ++i) result[i] = hsum(v[i]);
+	return result;
+}
+
+/*
+ * Gathers and scatters between an array of vec<float, N> (or of floats) and a packet. \a index holds the 8 element
+ * indices, lanes outside of \a active are not read or written and gather() leaves them 0.
+ */
+
+inline float8 gather(const float* base, const int32_t* index) {
+	return float8(_mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index)), 4));
+}
+
+inline float8 gather(const float* base, const int32_t* index, mask8 active) {
+	const __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index));
+	return float8(_mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, i, active.m, 4));
+}
+
+template <std::size_t N>
+inline vec<float8, N> gather(const vec<float, N>* base, const int32_t* index, mask8 active = true) {
+	static_assert(sizeof(vec<float, N>) == N * sizeof(float));
+	const __m256i offsets = _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(index)),
+											   _mm256_set1_epi32(int(N)));
+	const float*  floats  = base->data;
+	vec<float8, N> result;
+	for (std::size_t i = 0; i < N; ++i) {
+		result[i] = float8(_mm256_mask_i32gather_ps(_mm256_setzero_ps(), floats + i, offsets, active.m, 4));
+	}
+	return result;
+}
+
+/// 8 consecutive vectors
+template <std::size_t N>
+inline vec<float8, N> load(const vec<float, N>* base) {
+	static constexpr int32_t IOTA[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+	return gather(base, IOTA);
+}
+
+// AVX2 has no scatter instruction, the active lanes are stored one by one
+inline void scatter(float8 v, float* base, const int32_t* index, mask8 active = true) {
+	for (unsigned bits = active.bits(); bits; bits &= bits - 1) {
+		const int lane	  = std::countr_zero(bits);
+		base[index[lane]] = v[lane];
+	}
+}
+
+template <std::size_t N>
+inline void scatter(const vec<float8, N>& v, vec<float, N>* base, const int32_t* index, mask8 active = true) {
+	for (unsigned bits = active.bits(); bits; bits &= bits - 1) {
+		const int lane	  = std::countr_zero(bits);
+		base[index[lane]] = extract(v, lane);
+	}
+}
+
+template <std::size_t N>
+inline void store(const vec<float8, N>& v, vec<float, N>* base) {
+	for (std::size_t lane = 0; lane < float8::LANES; ++lane) base[lane] = extract(v, lane);
+}
+
+#endif
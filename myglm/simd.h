@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cmath>
+#include <myglm/mat.h>
+#include <myglm/vec3.h>
+#include <myglm/vec4.h>
+
+/*
+ * SSE versions of the most used vec4 and mat4 operations and vec3a, a vec3 padded to a whole SSE register. The vec4
+ * and mat4 operations are plain overloads, so they win over the generic templates whenever both operands are vec4 of float, and fall back
+ * to them in constant expressions. The generic path can still be selected explicitly, e.g. dot<float, 4>(a, b), which
+ * the benchmarks in test.cpp do.
+ *
+ * vec3 keeps the generic templates: loading its 12 bytes into a register and storing them back costs more than the
+ * arithmetic saves (see the benchmarks), so data that is worth vectorizing should be stored as vec3a instead.
+ *
+ * Only SSE2 is used, which every x86-64 CPU has. Define MYGLM_NO_SIMD to keep the generic templates only.
+ */
+
+#if defined(__SSE2__) && !defined(MYGLM_NO_SIMD)
+#define MYGLM_SIMD
+
+#include <emmintrin.h>
+
+namespace simd {
+/// x and y in one 8 byte load, z in a second one, the fourth lane is 0
+FORCE_INLINE __m128 load(const vec<float, 3>& v) {
+	__m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(v.data)));
+	return _mm_movelh_ps(xy, _mm_load_ss(v.data + 2));
+}
+FORCE_INLINE __m128 load(const vec<float, 4>& v) { return _mm_loadu_ps(v.data); }
+
+FORCE_INLINE vec<float, 4> store4(__m128 m) {
+	vec<float, 4> v;
+	_mm_storeu_ps(v.data, m);
+	return v;
+}
+
+template <int X, int Y, int Z, int W>
+FORCE_INLINE __m128 shuffle(__m128 m) {
+	return _mm_shuffle_ps(m, m, _MM_SHUFFLE(W, Z, Y, X));
+}
+
+/// lanes X and Y of \a a followed by lanes Z and W of \a b
+template <int X, int Y, int Z, int W>
+FORCE_INLINE __m128 shuffle(__m128 a, __m128 b) {
+	return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X));
+}
+
+/// \a r[0] * v.x + \a r[1] * v.y + \a r[2] * v.z + \a r[3] * v.w
+FORCE_INLINE __m128 combine(const __m128 (&r)[4], const float* v) {
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], _mm_set1_ps(v[0])), _mm_mul_ps(r[1], _mm_set1_ps(v[1]))),
+					  _mm_add_ps(_mm_mul_ps(r[2], _mm_set1_ps(v[2])), _mm_mul_ps(r[3], _mm_set1_ps(v[3]))));
+}
+
+/// x + y + z in that order, like the generic dot, in every lane
+FORCE_INLINE float hsum3(__m128 m) {
+	return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(m, shuffle<1, 1, 1, 1>(m)), shuffle<2, 2, 2, 2>(m)));
+}
+
+/// (x + y) + (z + w)
+FORCE_INLINE float hsum4(__m128 m) {
+	__m128 pairs = _mm_add_ps(m, shuffle<1, 0, 3, 2>(m));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_movehl_ps(pairs, pairs)));
+}
+
+/// a.yzx * b.zxy - a.zxy * b.yzx
+FORCE_INLINE __m128 cross(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(shuffle<1, 2, 0, 3>(a), shuffle<2, 0, 1, 3>(b)),
+					  _mm_mul_ps(shuffle<2, 0, 1, 3>(a), shuffle<1, 2, 0, 3>(b)));
+}
+}	  // namespace simd
+
+/*
+ * min and max take their operands in the order that returns the same element as std::min and std::max when one
+ * of them is NaN. The generic templates are used in constant expressions.
+ */
+#define MYGLM_SIMD_OPERATORS(V, STORE)                                                                  \
+	inline constexpr V operator+(const V& v1, const V& v2) {                                            \
+		if consteval { return operator+ <float, V::N>(v1, v2); }                                        \
+		return STORE(_mm_add_ps(simd::load(v1), simd::load(v2)));                                       \
+	}                                                                                                   \
+	inline constexpr V operator-(const V& v1, const V& v2) {                                            \
+		if consteval { return operator- <float, V::N>(v1, v2); }                                        \
+		return STORE(_mm_sub_ps(simd::load(v1), simd::load(v2)));                                       \
+	}                                                                                                   \
+	inline constexpr V operator*(const V& v1, const V& v2) {                                            \
+		if consteval { return operator* <float, V::N>(v1, v2); }                                        \
+		return STORE(_mm_mul_ps(simd::load(v1), simd::load(v2)));                                       \
+	}                                                                                                   \
+	inline constexpr V operator/(const V& v1, const V& v2) {                                            \
+		if consteval { return operator/ <float, V::N>(v1, v2); }                                        \
+		return STORE(_mm_div_ps(simd::load(v1), simd::load(v2)));                                       \
+	}                                                                                                   \
+	inline constexpr V operator+(const V& v, float s) {                                                 \
+		if consteval { return operator+ <float, V::N>(v, s); }                                          \
+		return STORE(_mm_add_ps(simd::load(v), _mm_set1_ps(s)));                                        \
+	}                                                                                                   \
+	inline constexpr V operator-(const V& v, float s) {                                                 \
+		if consteval { return operator- <float, V::N>(v, s); }                                          \
+		return STORE(_mm_sub_ps(simd::load(v), _mm_set1_ps(s)));                                        \
+	}                                                                                                   \
+	inline constexpr V operator*(const V& v, float s) {                                                 \
+		if consteval { return operator* <float, V::N>(v, s); }                                          \
+		return STORE(_mm_mul_ps(simd::load(v), _mm_set1_ps(s)));                                        \
+	}                                                                                                   \
+	inline constexpr V operator/(const V& v, float s) {                                                 \
+		if consteval { return operator/ <float, V::N>(v, s); }                                          \
+		return STORE(_mm_div_ps(simd::load(v), _mm_set1_ps(s)));                                        \
+	}                                                                                                   \
+	inline constexpr V operator-(const V& v) {                                                          \
+		if consteval { return operator- <float, V::N>(v); }                                             \
+		return STORE(_mm_xor_ps(simd::load(v), _mm_set1_ps(-0.f)));                                     \
+	}                                                                                                   \
+	inline constexpr V& operator+=(V& v1, const V& v2) { return v1 = v1 + v2; }                         \
+	inline constexpr V& operator-=(V& v1, const V& v2) { return v1 = v1 - v2; }                         \
+	inline constexpr V& operator*=(V& v1, const V& v2) { return v1 = v1 * v2; }                         \
+	inline constexpr V& operator/=(V& v1, const V& v2) { return v1 = v1 / v2; }                         \
+	inline constexpr V& operator+=(V& v, float s) { return v = v + s; }                                 \
+	inline constexpr V& operator-=(V& v, float s) { return v = v - s; }                                 \
+	inline constexpr V& operator*=(V& v, float s) { return v = v * s; }                                 \
+	inline constexpr V& operator/=(V& v, float s) { return v = v / s; }                                 \
+	inline constexpr V min(const V& v1, const V& v2) {                                                  \
+		if consteval { return min<float, V::N>(v1, v2); }                                               \
+		return STORE(_mm_min_ps(simd::load(v2), simd::load(v1)));                                       \
+	}                                                                                                   \
+	inline constexpr V max(const V& v1, const V& v2) {                                                  \
+		if consteval { return max<float, V::N>(v1, v2); }                                               \
+		return STORE(_mm_max_ps(simd::load(v2), simd::load(v1)));                                       \
+	}                                                                                                   \
+	inline constexpr float lengthSquared(const V& v) { return dot(v, v); }                              \
+	inline constexpr float length(const V& v) {                                                         \
+		if consteval { return length<float, V::N>(v); }                                                 \
+		return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(dot(v, v))));                                       \
+	}                                                                                                   \
+	inline constexpr V normalize(const V& v) {                                                          \
+		if consteval { return normalize<float, V::N>(v); }                                              \
+		const float len = length(v);                                                                    \
+		if (len < 1e-6f) return v; /* zero length vectors are returned as they are */                   \
+		return STORE(_mm_div_ps(simd::load(v), _mm_set1_ps(len)));                                      \
+	}
+
+/// sums as (x + y) + (z + w), which may differ from the generic dot in the last bit
+inline constexpr float dot(const vec<float, 4>& v1, const vec<float, 4>& v2) {
+	if consteval { return dot<float, 4>(v1, v2); }
+	return simd::hsum4(_mm_mul_ps(simd::load(v1), simd::load(v2)));
+}
+
+MYGLM_SIMD_OPERATORS(vec4, simd::store4)
+#undef MYGLM_SIMD_OPERATORS
+
+/*
+ * mat4 is stored by rows. mat4 * vec4 multiplies all rows with the vector at once and transposes the products, so
+ * that they are summed vertically; vec4 * mat4 and mat4 * mat4 add up rows weighted by broadcast coordinates and
+ * need no transposed copy.
+ */
+
+inline constexpr mat4 transpose(const mat4& m) {
+	if consteval { return transpose<float, 4, 4>(m); }
+	__m128 r0 = simd::load(m[0]), r1 = simd::load(m[1]), r2 = simd::load(m[2]), r3 = simd::load(m[3]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	return mat4(simd::store4(r0), simd::store4(r1), simd::store4(r2), simd::store4(r3));
+}
+
+inline constexpr vec4 operator*(const mat4& m, const vec4& v) {
+	if consteval { return operator* <float, 4, 4>(m, v); }
+	const __m128 x	= simd::load(v);
+	__m128		 p0 = _mm_mul_ps(simd::load(m[0]), x), p1 = _mm_mul_ps(simd::load(m[1]), x);
+	__m128		 p2 = _mm_mul_ps(simd::load(m[2]), x), p3 = _mm_mul_ps(simd::load(m[3]), x);
+	_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+	return simd::store4(_mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)));
+}
+
+inline constexpr vec4 operator*(const vec4& v, const mat4& m) {
+	if consteval { return operator* <float, 4, 4>(v, m); }
+	const __m128 rows[4] = {simd::load(m[0]), simd::load(m[1]), simd::load(m[2]), simd::load(m[3])};
+	return simd::store4(simd::combine(rows, v.data));
+}
+
+/// result[i][j] = dot(m1[i], m2[j]) like the generic version, so every row of the result is m2 * m1[i]
+inline constexpr mat4 operator*(const mat4& m1, const mat4& m2) {
+	if consteval { return operator* <float, 4, 4, 4>(m1, m2); }
+	__m128 t[4] = {simd::load(m2[0]), simd::load(m2[1]), simd::load(m2[2]), simd::load(m2[3])};
+	_MM_TRANSPOSE4_PS(t[0], t[1], t[2], t[3]);
+	mat4 result;
+	for (std::size_t i = 0; i < 4; ++i) result[i] = simd::store4(simd::combine(t, m1[i].data));
+	return result;
+}
+
+/**
+ * vec3 padded to 16 bytes and 16 byte aligned, so that it is loaded and stored as a whole SSE register. Meant for
+ * arrays that hot loops read many times, like vertex positions or ray directions. The padding lane \a w is not
+ * meaningful, operations keep it but dot, length and comparisons ignore it.
+ */
+class alignas(16) vec3a {
+   public:
+	union {
+		__m128 m;
+		float  data[4];
+		struct {
+			float x, y, z, w;
+		};
+	};
+
+	static constexpr unsigned int N = 3;
+
+	inline vec3a() : m(_mm_setzero_ps()) {}
+	inline explicit vec3a(__m128 m) : m(m) {}
+	inline explicit vec3a(float s) : m(_mm_setr_ps(s, s, s, 0.f)) {}
+	inline vec3a(float x, float y, float z) : m(_mm_setr_ps(x, y, z, 0.f)) {}
+	inline explicit vec3a(const vec<float, 3>& v) : m(simd::load(v)) {}
+
+	inline operator vec<float, 3>() const { return vec<float, 3>(x, y, z); }
+
+	inline float&		operator[](std::size_t i) { return data[i]; }
+	inline const float& operator[](std::size_t i) const { return data[i]; }
+	inline std::size_t	size() const { return N; }
+};
+
+static_assert(sizeof(vec3a) == 16 && alignof(vec3a) == 16);
+
+inline vec3a operator+(vec3a a, vec3a b) { return vec3a(_mm_add_ps(a.m, b.m)); }
+inline vec3a operator-(vec3a a, vec3a b) { return vec3a(_mm_sub_ps(a.m, b.m)); }
+inline vec3a operator*(vec3a a, vec3a b) { return vec3a(_mm_mul_ps(a.m, b.m)); }
+inline vec3a operator/(vec3a a, vec3a b) { return vec3a(_mm_div_ps(a.m, b.m)); }
+inline vec3a operator+(vec3a a, float s) { return vec3a(_mm_add_ps(a.m, _mm_set1_ps(s))); }
+inline vec3a operator-(vec3a a, float s) { return vec3a(_mm_sub_ps(a.m, _mm_set1_ps(s))); }
+inline vec3a operator*(vec3a a, float s) { return vec3a(_mm_mul_ps(a.m, _mm_set1_ps(s))); }
+inline vec3a operator/(vec3a a, float s) { return vec3a(_mm_div_ps(a.m, _mm_set1_ps(s))); }
+inline vec3a operator-(vec3a a) { return vec3a(_mm_xor_ps(a.m, _mm_set1_ps(-0.f))); }
+inline vec3a& operator+=(vec3a& a, vec3a b) { return a = a + b; }
+inline vec3a& operator-=(vec3a& a, vec3a b) { return a = a - b; }
+inline vec3a& operator*=(vec3a& a, vec3a b) { return a = a * b; }
+inline vec3a& operator/=(vec3a& a, vec3a b) { return a = a / b; }
+inline vec3a& operator+=(vec3a& a, float s) { return a = a + s; }
+inline vec3a& operator-=(vec3a& a, float s) { return a = a - s; }
+inline vec3a& operator*=(vec3a& a, float s) { return a = a * s; }
+inline vec3a& operator/=(vec3a& a, float s) { return a = a / s; }
+
+inline bool operator==(vec3a a, vec3a b) { return (_mm_movemask_ps(_mm_cmpeq_ps(a.m, b.m)) & 0x7) == 0x7; }
+inline bool operator!=(vec3a a, vec3a b) { return !(a == b); }
+
+inline float dot(vec3a a, vec3a b) { return simd::hsum3(_mm_mul_ps(a.m, b.m)); }
+inline float lengthSquared(vec3a a) { return dot(a, a); }
+inline float length(vec3a a) { return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(dot(a, a)))); }
+inline vec3a cross(vec3a a, vec3a b) { return vec3a(simd::cross(a.m, b.m)); }
+inline vec3a min(vec3a a, vec3a b) { return vec3a(_mm_min_ps(b.m, a.m)); }
+inline vec3a max(vec3a a, vec3a b) { return vec3a(_mm_max_ps(b.m, a.m)); }
+
+inline vec3a normalize(vec3a a) {
+	const float len = length(a);
+	if (len < 1e-6f) return a;	   // zero length vectors are returned as they are
+	return a / len;
+}
+
+inline std::ostream& operator<<(std::ostream& out, vec3a v) { return out << vec<float, 3>(v); }
+
+#else
+using vec3a = vec3;
+#endif
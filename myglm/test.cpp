@@ -99,3 +99,491 @@ TEST_CASE("composition") {
 	vec2 v2{3.f, 4.f};
 	vec4 v3(v1, 1.f, 2.f);
 }
+
+TEST_CASE("simd matches the generic templates") {
+	const vec4 u{1.5f, -2.25f, 3.f, 4.f}, v{0.5f, 4.f, -1.75f, 8.f};
+	CHECK(u + v == operator+ <float, 4>(u, v));
+	CHECK(u - v == operator- <float, 4>(u, v));
+	CHECK(u * v == operator* <float, 4>(u, v));
+	CHECK(u / v == operator/ <float, 4>(u, v));
+	CHECK(u * 3.f == operator* <float, 4>(u, 3.f));
+	CHECK(-u == operator- <float, 4>(u));
+	CHECK(dot(u, v) == doctest::Approx(dot<float, 4>(u, v)));
+	CHECK(length(u) == doctest::Approx(length<float, 4>(u)));
+	CHECK(normalize(u)[0] == doctest::Approx(normalize<float, 4>(u)[0]));
+	CHECK(min(u, v) == min<float, 4>(u, v));
+	CHECK(max(u, v) == max<float, 4>(u, v));
+
+	vec4 c = u;
+	c += v;
+	c *= 2.f;
+	CHECK(c == (u + v) * 2.f);
+}
+
+TEST_CASE("simd min and max keep the NaN behaviour of std::min and std::max") {
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const vec4	a{nan, 1.f, 2.f, nan}, b{0.f, nan, 3.f, nan};
+	const vec4	lo = min(a, b), hi = max(a, b);
+	const vec4	glo = min<float, 4>(a, b), ghi = max<float, 4>(a, b);
+	for (int i = 0; i < 4; ++i) {
+		CHECK(std::isnan(lo[i]) == std::isnan(glo[i]));
+		CHECK(std::isnan(hi[i]) == std::isnan(ghi[i]));
+	}
+}
+
+TEST_CASE("normalize returns zero length vectors as they are") {
+	CHECK(normalize(vec4(0.f)) == vec4(0.f));
+	CHECK(normalize(vec3(0.f)) == vec3(0.f));
+	CHECK(vec3(normalize(vec3a(vec3(0.f)))) == vec3(0.f));
+	CHECK(normalize<float, 4>(vec4(0.f)) == vec4(0.f));
+	CHECK(length(normalize(vec4(1e-3f, 0.f, 0.f, 0.f))) == doctest::Approx(1.f));
+}
+
+TEST_CASE("simd operators in constant expressions") {
+	constexpr vec4 c = vec4(1.f, 2.f, 3.f, 4.f) + vec4(1.f, 1.f, 1.f, 1.f);
+	static_assert(c[0] == 2.f && c[1] == 3.f && c[2] == 4.f && c[3] == 5.f);
+	static_assert(dot(vec4(1.f, 2.f, 3.f, 4.f), vec4(1.f, 1.f, 1.f, 1.f)) == 10.f);
+}
+
+TEST_CASE("vec3a") {
+#ifdef MYGLM_SIMD
+	CHECK(sizeof(vec3a) == 16);
+	CHECK(alignof(vec3a) == 16);
+#endif
+
+	const vec3	a{1.5f, -2.25f, 3.f}, b{0.5f, 4.f, -1.75f};
+	const vec3a aa(a), ba(b);
+	CHECK(vec3(aa + ba) == a + b);
+	CHECK(vec3(aa * 2.f - ba) == a * 2.f - b);
+	CHECK(dot(aa, ba) == dot(a, b));
+	CHECK(vec3(cross(aa, ba)) == cross(a, b));
+	CHECK(vec3(normalize(aa)) == normalize(a));
+	CHECK(length(aa) == length(a));
+	CHECK(aa == vec3a(a));
+	CHECK(aa != ba);
+}
+
+static void checkClose(const mat4 &a, const mat4 &b) {
+	for (std::size_t i = 0; i < 4; ++i)
+		for (std::size_t j = 0; j < 4; ++j) CHECK(a[i][j] == doctest::Approx(b[i][j]).epsilon(1e-5));
+}
+
+TEST_CASE("simd mat4 matches the generic templates") {
+	const mat4 m(vec4(2.f, 0.5f, -1.f, 3.f), vec4(0.f, 1.5f, 4.f, -2.f), vec4(1.f, -3.f, 2.5f, 0.5f),
+				 vec4(0.25f, 1.f, -0.5f, 2.f));
+	const mat4 n(vec4(1.f, 2.f, 3.f, 4.f), vec4(-1.f, 0.f, 2.f, 1.f), vec4(0.5f, 0.5f, -2.f, 3.f),
+				 vec4(4.f, -1.f, 0.f, 1.f));
+	const vec4 v{1.5f, -2.f, 0.25f, 1.f};
+
+	const vec4 mv = m * v, gmv = operator* <float, 4, 4>(m, v);
+	const vec4 vm = v * m, gvm = operator* <float, 4, 4>(v, m);
+	for (std::size_t i = 0; i < 4; ++i) {
+		CHECK(mv[i] == doctest::Approx(gmv[i]));
+		CHECK(vm[i] == doctest::Approx(gvm[i]));
+	}
+	CHECK(transpose(m) == transpose<float, 4, 4>(m));
+	checkClose(m * n, operator* <float, 4, 4, 4>(m, n));
+	checkClose(invert(m), invert<float>(m));
+	checkClose(invert(m) * transpose(m), identity<float, 4>());
+	CHECK_THROWS(invert(mat4(vec4(1.f, 2.f, 3.f, 4.f), vec4(2.f, 4.f, 6.f, 8.f), vec4(0.f, 1.f, 0.f, 0.f),
+							 vec4(0.f, 0.f, 1.f, 0.f))));
+}
+
+TEST_CASE("affine3") {
+	const mat4 m(vec4(0.f, -2.f, 0.f, 5.f), vec4(1.5f, 0.f, 0.5f, -1.f), vec4(0.f, 0.f, 3.f, 2.f),
+				 vec4(0.f, 0.f, 0.f, 1.f));
+	const affine3 a(m), inv = a.inverse();
+	const vec3	  p{1.f, 2.f, -3.f};
+
+	const vec3 point = a.transformPoint(p), direction = a.transformVector(p);
+	const vec4 expectedPoint = m * vec4(p, 1.f), expectedDirection = m * vec4(p, 0.f);
+	for (std::size_t i = 0; i < 3; ++i) {
+		CHECK(point[i] == doctest::Approx(expectedPoint[i]));
+		CHECK(direction[i] == doctest::Approx(expectedDirection[i]));
+	}
+
+	const vec3 back = inv.transformPoint(point), backDirection = inv.transformVector(direction);
+	for (std::size_t i = 0; i < 3; ++i) {
+		CHECK(back[i] == doctest::Approx(p[i]));
+		CHECK(backDirection[i] == doctest::Approx(p[i]));
+	}
+	CHECK(affine3().transformPoint(p) == p);
+	CHECK_THROWS(affine3(mat4(0.f)).inverse());
+}
+
+enum class ErrorKind { Absolute, Relative, Scaled };
+
+/// largest error of \a approx against \a exact over \a count points evenly spread over [lo, hi], Scaled divides
+/// the error by max(1, |exact|)
+template <class F, class G>
+static double maxError(F &&approx, G &&exact, double lo, double hi, ErrorKind kind, int count = 1000000) {
+	double worst = 0.;
+	for (int i = 0; i <= count; ++i) {
+		const float	 x	   = float(lo + (hi - lo) * i / count);
+		const double e	   = exact(double(x)), a = approx(x);
+		double		 error = std::abs(a - e);
+		if (kind == ErrorKind::Relative) error /= std::abs(e);
+		if (kind == ErrorKind::Scaled) error /= std::max(1., std::abs(e));
+		worst = std::max(worst, error);
+	}
+	return worst;
+}
+
+#ifndef MYGLM_PRECISE_MATH
+TEST_CASE("fast math error bounds") {
+	using enum ErrorKind;
+	const double pi = 3.14159265358979323846;
+	auto		 sin = [](double x) { return std::sin(x); };
+	CHECK(maxError([](float x) { return fast::rsqrt(x); }, [](double x) { return 1. / std::sqrt(x); }, 1e-6, 1e6,
+				   Relative) < 3e-7);
+	CHECK(maxError([](float x) { return fast::sin(x); }, sin, -8192., 8192., Absolute) < 1e-7);
+	CHECK(maxError([](float x) { return fast::sin(x); }, sin, 0., 2. * pi, Absolute) < 1e-7);
+	CHECK(maxError([](float x) { return fast::cos(x); }, [](double x) { return std::cos(x); }, -8192., 8192.,
+				   Absolute) < 1e-7);
+	CHECK(maxError([](float x) { return fast::exp(x); }, [](double x) { return std::exp(x); }, -87., 88., Relative) <
+		  1e-7);
+	CHECK(maxError([](float x) { return fast::exp2(x); }, [](double x) { return std::exp2(x); }, -126., 127.,
+				   Relative) < 1e-7);
+	CHECK(maxError([](float x) { return fast::log2(x); }, [](double x) { return std::log2(x); }, 1e-30, 1e30,
+				   Scaled) < 1e-7);
+	CHECK(maxError([](float x) { return fast::log2(x); }, [](double x) { return std::log2(x); }, 0.5, 2., Absolute) <
+		  1e-7);
+	// |y * log2(x)| reaches 24, 16 and 113
+	CHECK(maxError([](float x) { return fast::pow(x, 2.4f); }, [](double x) { return std::pow(x, 2.4); }, 1e-3, 1.,
+				   Relative) < 1e-7 * 25.);
+	CHECK(maxError([](float x) { return fast::pow(0.8f, x); }, [](double x) { return std::pow(0.8f, x); }, -50., 50.,
+				   Relative) < 1e-7 * 17.);
+	CHECK(maxError([](float x) { return fast::pow(x, 20.f); }, [](double x) { return std::pow(x, 20.); }, 0.1, 50.,
+				   Relative) < 1e-7 * 114.);
+
+	CHECK(fast::exp(-100.f) == 0.f);
+	CHECK(fast::exp(100.f) == INFINITY);
+	CHECK(fast::exp(0.f) == 1.f);
+	CHECK(fast::exp2(-200.f) == 0.f);
+	CHECK(fast::log2(0.f) == -INFINITY);
+	CHECK(std::isnan(fast::log2(-1.f)));
+	CHECK(fast::pow(0.f, 2.f) == 0.f);
+	CHECK(fast::pow(2.f, 10.f) == doctest::Approx(1024.f));
+}
+#endif
+
+TEST_CASE("fast::pow with a zero exponent is 1 like std::pow") {
+	for (float x : {0.f, -0.f, 1.f, 2.5f, -3.f, INFINITY, -INFINITY, NAN}) {
+		CHECK(fast::pow(x, 0.f) == 1.f);
+		CHECK(fast::pow(x, -0.f) == 1.f);
+		CHECK(fast::pow(x, 0.f) == std::pow(x, 0.f));
+	}
+#ifdef MYGLM_PACKET
+	const float8 x(0.f, -0.f, 1.f, 2.5f, -3.f, INFINITY, -INFINITY, NAN), w = fast::pow(x, float8(0.f));
+	for (std::size_t i = 0; i < 8; ++i) CHECK(w[i] == 1.f);
+	CHECK(fast::pow(float8(0.f), float8(2.f))[0] == 0.f);
+#endif
+}
+
+TEST_CASE("fast math helpers") {
+	CHECK(fast::pown<0>(3.f) == 1.f);
+	CHECK(fast::pown<5>(0.5f) == 0.03125f);
+	CHECK(fast::pown<7>(-2.f) == -128.f);
+	static_assert(fast::pown<3>(2.f) == 8.f);
+
+	float s, c;
+	fast::sincos(1.f, s, c);
+	CHECK(s == doctest::Approx(std::sin(1.f)));
+	CHECK(c == doctest::Approx(std::cos(1.f)));
+
+	const vec3 n = fast::normalize(vec3(3.f, 0.f, 4.f)), e = fast::exp(vec3(0.f, 1.f, -1.f));
+	CHECK(n[0] == doctest::Approx(0.6f));
+	CHECK(n[2] == doctest::Approx(0.8f));
+	CHECK(e[1] == doctest::Approx(std::exp(1.f)));
+	CHECK(e[2] == doctest::Approx(std::exp(-1.f)));
+}
+
+#ifdef MYGLM_PACKET
+TEST_CASE("fast math on float8 matches float") {
+	const float8 x(-20.f, -3.f, -0.5f, 0.f, 0.25f, 1.f, 7.5f, 80.f), p = abs(x) + 0.125f;
+	float8		 s, c;
+	fast::sincos(x, s, c);
+	const float8 e = fast::exp(x), l = fast::log2(p), w = fast::pow(p, float8(1.5f)), r = fast::rsqrt(p);
+	for (std::size_t i = 0; i < 8; ++i) {
+		CHECK(s[i] == doctest::Approx(fast::sin(x[i])).epsilon(1e-6));
+		CHECK(c[i] == doctest::Approx(fast::cos(x[i])).epsilon(1e-6));
+		CHECK(e[i] == doctest::Approx(fast::exp(x[i])).epsilon(1e-6));
+		CHECK(l[i] == doctest::Approx(fast::log2(p[i])).epsilon(1e-6));
+		CHECK(w[i] == doctest::Approx(fast::pow(p[i], 1.5f)).epsilon(1e-6));
+		CHECK(r[i] == doctest::Approx(fast::rsqrt(p[i])).epsilon(1e-6));
+	}
+	const vec3x8 n = fast::normalize(broadcast(vec3(3.f, 0.f, 4.f)));
+	CHECK(hmax(abs(n[0] - 0.6f)) < 1e-6f);
+}
+#endif
+
+#ifdef MYGLM_PACKET
+TEST_CASE("float8 and mask8") {
+	const float8 a(1.f, -2.f, 3.f, -4.f, 5.f, -6.f, 7.f, -8.f), b(2.f);
+	const mask8	 positive = a > 0.f;
+	CHECK(positive.bits() == 0x55);
+	CHECK(count(positive) == 4);
+	CHECK(any(positive));
+	CHECK(!all(positive));
+	CHECK(none(positive & !positive));
+	CHECK(all(positive | !positive));
+
+	const float8 s = select(positive, a, b);
+	for (std::size_t i = 0; i < 8; ++i) CHECK(s[i] == (a[i] > 0.f ? a[i] : 2.f));
+	CHECK(hsum(a) == -4.f);
+	CHECK(hmin(a) == -8.f);
+	CHECK(hmax(a) == 7.f);
+	CHECK(hsum(abs(a)) == 36.f);
+	CHECK(fmadd(a, b, 1.f)[3] == -7.f);
+
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float8 n(nan, 1.f, nan, 1.f, 0.f, 0.f, 0.f, 0.f);
+	CHECK(isnan(n).bits() == 0x5);
+	CHECK(std::isnan(min(n, b)[0]) == std::isnan(std::min(nan, 2.f)));
+	CHECK(std::isnan(min(b, n)[0]) == std::isnan(std::min(2.f, nan)));
+	CHECK((n != n).bits() == 0x5);
+}
+
+TEST_CASE("packets compose with the generic templates") {
+	vec3 a[8], b[8];
+	for (int i = 0; i < 8; ++i) {
+		a[i] = vec3(float(i) + 1.f, 2.f - float(i), 0.5f * float(i));
+		b[i] = vec3(-1.f, float(i) * 0.25f, 3.f);
+	}
+	const vec3x8 pa = load(a), pb = load(b);
+
+	const float8 d = dot(pa, pb);
+	const vec3x8 c = cross(pa, pb), n = normalize(pa), r = reflect(pa, normalize(pb)), m = min(pa, pb) * 2.f;
+	const float8 len = length(pa);
+	for (std::size_t i = 0; i < 8; ++i) {
+		CHECK(d[i] == doctest::Approx(dot(a[i], b[i])));
+		CHECK(extract(c, i) == cross(a[i], b[i]));
+		CHECK(len[i] == doctest::Approx(length(a[i])));
+		for (std::size_t k = 0; k < 3; ++k) {
+			CHECK(extract(n, i)[k] == doctest::Approx(normalize(a[i])[k]));
+			CHECK(extract(r, i)[k] == doctest::Approx(reflect(a[i], normalize(b[i]))[k]));
+		}
+		CHECK(extract(m, i) == min(a[i], b[i]) * 2.f);
+	}
+
+	const mask8 equal = pa == select(d > 0.f, pa, pb);
+	CHECK(equal.bits() == (d > 0.f).bits());
+	CHECK(hsum(broadcast(vec3(1.f, 2.f, 3.f))) == vec3(8.f, 16.f, 24.f));
+}
+
+TEST_CASE("packet gather and scatter") {
+	vec3 points[16];
+	for (int i = 0; i < 16; ++i) points[i] = vec3(float(i), float(10 * i), float(100 * i));
+	const int32_t index[8] = {15, 0, 3, 3, 8, 1, 12, 7};
+
+	const vec3x8 p = gather(points, index);
+	for (std::size_t i = 0; i < 8; ++i) CHECK(extract(p, i) == points[index[i]]);
+
+	const mask8	 active = float8(0.f, 1.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f) > 0.f;
+	const vec3x8 q		= gather(points, index, active);
+	for (std::size_t i = 0; i < 8; ++i) CHECK(extract(q, i) == (active[i] ? points[index[i]] : vec3(0.f)));
+
+	const float8 x = gather(points[0].data, index);
+	CHECK(x[0] == points[5].x);	 // float 15 is the x of vec3 5
+	CHECK(x[1] == 0.f);
+
+	vec3 out[16] = {};
+	scatter(p * 2.f, out, index, active);
+	for (int i = 0; i < 16; ++i) {
+		bool written = false;
+		for (std::size_t l = 0; l < 8; ++l) written |= active[l] && index[l] == i;
+		CHECK(out[i] == (written ? points[i] * 2.f : vec3(0.f)));
+	}
+
+	vec3 stored[8];
+	store(p, stored);
+	for (std::size_t i = 0; i < 8; ++i) CHECK(stored[i] == points[index[i]]);
+}
+#endif
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+/// times \a func over \a rounds runs, returns ns per element
+template <class F>
+static double benchmark(std::size_t elements, int rounds, F &&func) {
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; ++r) {
+		func();
+		// keeps the compiler from merging the rounds
+		asm volatile("" ::: "memory");
+	}
+	auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	return ns / (double(elements) * rounds);
+}
+
+// run with --no-skip -ts=benchmark
+TEST_SUITE("benchmark" * doctest::skip()) {
+	TEST_CASE("vec3a against vec3") {
+		constexpr std::size_t			N = 4096;
+		constexpr int					ROUNDS = 2000;
+		std::mt19937					rng(1);
+		std::uniform_real_distribution	dist(-1.f, 1.f);
+		std::vector<vec3>				a(N), b(N), out(N);
+		std::vector<vec3a>				aa(N), ba(N), outa(N);
+		for (std::size_t i = 0; i < N; ++i) {
+			a[i]  = vec3(dist(rng), dist(rng), dist(rng));
+			b[i]  = vec3(dist(rng), dist(rng), dist(rng));
+			aa[i] = vec3a(a[i]);
+			ba[i] = vec3a(b[i]);
+		}
+		float sink = 0.f;
+
+		double generic = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) {
+				out[i] = normalize(cross(a[i], b[i]) + a[i] * 0.5f);
+				sink += dot(out[i], b[i]);
+			}
+		});
+		double aligned = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) {
+				outa[i] = normalize(cross(aa[i], ba[i]) + aa[i] * 0.5f);
+				sink += dot(outa[i], ba[i]);
+			}
+		});
+		MESSAGE("cross + normalize + dot, ns per element: vec3 ", generic, ", vec3a ", aligned);
+
+		double genericDot = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) sink += dot(a[i], b[i]);
+		});
+		double alignedDot = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) sink += dot(aa[i], ba[i]);
+		});
+		MESSAGE("dot, ns per element: vec3 ", genericDot, ", vec3a ", alignedDot);
+		CHECK(std::isfinite(sink));
+	}
+
+	TEST_CASE("vec4 simd against generic") {
+		constexpr std::size_t			N = 4096;
+		constexpr int					ROUNDS = 2000;
+		std::mt19937					rng(2);
+		std::uniform_real_distribution	dist(-1.f, 1.f);
+		std::vector<vec4>				a(N), b(N), out(N);
+		for (std::size_t i = 0; i < N; ++i) {
+			a[i] = vec4(dist(rng), dist(rng), dist(rng), dist(rng));
+			b[i] = vec4(dist(rng), dist(rng), dist(rng), dist(rng));
+		}
+		float sink = 0.f;
+
+		double generic = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) {
+				out[i] = operator+ <float, 4>(operator* <float, 4>(a[i], b[i]), operator* <float, 4>(out[i], 0.5f));
+				sink += dot<float, 4>(out[i], a[i]);
+			}
+		});
+		double simd = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) {
+				out[i] = a[i] * b[i] + out[i] * 0.5f;
+				sink += dot(out[i], a[i]);
+			}
+		});
+		MESSAGE("mul + mad + dot, ns per element: generic ", generic, ", vec4 ", simd);
+		CHECK(std::isfinite(sink));
+	}
+
+	TEST_CASE("mat4 simd against generic") {
+		constexpr std::size_t			N = 4096;
+		constexpr int					ROUNDS = 500;
+		std::mt19937					rng(4);
+		std::uniform_real_distribution	dist(-1.f, 1.f);
+		const mat4 m(vec4(2.f, 0.5f, -1.f, 3.f), vec4(0.f, 1.5f, 4.f, -2.f), vec4(1.f, -3.f, 2.5f, 0.5f),
+					 vec4(0.f, 0.f, 0.f, 1.f));
+		const affine3	  a(m);
+		std::vector<vec3> points(N), out(N);
+		for (auto &p : points) p = vec3(dist(rng), dist(rng), dist(rng));
+
+		double generic = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) out[i] = operator* <float, 4, 4>(m, vec4(points[i], 1.f))._xyz();
+		});
+		double simd = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) out[i] = (m * vec4(points[i], 1.f))._xyz();
+		});
+		double affine = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) out[i] = a.transformPoint(points[i]);
+		});
+		MESSAGE("transform point, ns per point: generic mat4 ", generic, ", mat4 ", simd, ", affine3 ", affine);
+
+		// a rotation keeps the chained products bounded, inverting twice gives the matrix back
+		const float c = std::cos(0.1f), s = std::sin(0.1f);
+		const mat4	r(vec4(c, -s, 0.f, 0.f), vec4(s, c, 0.f, 0.f), vec4(0.f, 0.f, 1.f, 0.f), vec4(0.f, 0.f, 0.f, 1.f));
+		mat4		acc = r;
+		double		genericMul = benchmark(1, 100000, [&]() { acc = operator* <float, 4, 4, 4>(acc, r); });
+		double		simdMul	   = benchmark(1, 100000, [&]() { acc = acc * r; });
+		acc					   = m;
+		double genericInv	   = benchmark(1, 100000, [&]() { acc = invert<float>(acc); });
+		double simdInv		   = benchmark(1, 100000, [&]() { acc = invert(acc); });
+		MESSAGE("mat4 * mat4, ns: generic ", genericMul, ", simd ", simdMul);
+		MESSAGE("invert, ns: generic ", genericInv, ", simd ", simdInv);
+		CHECK(std::isfinite(out[0][0] + acc[0][0]));
+	}
+
+	TEST_CASE("fast math against std") {
+		constexpr std::size_t			N = 4096;
+		constexpr int					ROUNDS = 500;
+		std::mt19937					rng(5);
+		std::uniform_real_distribution	dist(0.f, 6.f);
+		std::vector<float>				in(N), out(N);
+		for (auto &x : in) x = dist(rng);
+
+		auto run = [&](auto &&func) {
+			return benchmark(N, ROUNDS, [&]() {
+				for (std::size_t i = 0; i < N; ++i) out[i] = func(in[i]);
+			});
+		};
+		MESSAGE("sin, ns: std ", run([](float x) { return std::sin(x); }), ", fast ", run([](float x) { return fast::sin(x); }));
+		MESSAGE("exp, ns: std ", run([](float x) { return std::exp(-x); }), ", fast ", run([](float x) { return fast::exp(-x); }));
+		MESSAGE("pow, ns: std ", run([](float x) { return std::pow(x, 2.4f); }), ", fast ",
+				run([](float x) { return fast::pow(x, 2.4f); }));
+		MESSAGE("rsqrt, ns: std ", run([](float x) { return 1.f / std::sqrt(x); }), ", fast ",
+				run([](float x) { return fast::rsqrt(x); }));
+#ifdef MYGLM_PACKET
+		double sin8 = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; i += 8) fast::sin(float8::load(&in[i])).store(&out[i]);
+		});
+		MESSAGE("sin, ns: float8 ", sin8);
+#endif
+		CHECK(std::isfinite(out[0]));
+	}
+
+#ifdef MYGLM_PACKET
+	TEST_CASE("vec3x8 against vec3") {
+		constexpr std::size_t			N = 4096;
+		constexpr int					ROUNDS = 2000;
+		std::mt19937					rng(3);
+		std::uniform_real_distribution	dist(-1.f, 1.f);
+		std::vector<vec3>				a(N), b(N), out(N);
+		for (std::size_t i = 0; i < N; ++i) {
+			a[i] = vec3(dist(rng), dist(rng), dist(rng));
+			b[i] = vec3(dist(rng), dist(rng), dist(rng));
+		}
+		std::vector<vec3x8> pa(N / 8), pb(N / 8), pout(N / 8);
+		for (std::size_t i = 0; i < N / 8; ++i) {
+			pa[i] = load(&a[8 * i]);
+			pb[i] = load(&b[8 * i]);
+		}
+		float  sink	 = 0.f;
+		float8 psink = 0.f;
+
+		double scalar = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N; ++i) {
+				out[i] = normalize(cross(a[i], b[i]) + a[i] * 0.5f);
+				sink += dot(out[i], b[i]);
+			}
+		});
+		double packet = benchmark(N, ROUNDS, [&]() {
+			for (std::size_t i = 0; i < N / 8; ++i) {
+				pout[i] = normalize(cross(pa[i], pb[i]) + pa[i] * 0.5f);
+				psink += dot(pout[i], pb[i]);
+			}
+		});
+		MESSAGE("cross + normalize + dot, ns per element: vec3 ", scalar, ", vec3x8 ", packet);
+		CHECK(std::isfinite(sink + hsum(psink)));
+	}
+#endif
+}
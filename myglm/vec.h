@@ -139,7 +139,7 @@ inline constexpr auto operator*=(vec<T, N>& v1, const vec<T, N>& v2) {
 }
 
 template <class T, std::size_t N>
-inline constexpr auto operator/(vec<T, N>& v1, const vec<T, N>& v2) {
+inline constexpr auto operator/=(vec<T, N>& v1, const vec<T, N>& v2) {
 	return apply2_inplace(v1, v2, std::divides<T>{});
 }
 
@@ -211,13 +211,14 @@ inline constexpr auto lengthSquared(const vec<T, N>& v) {
 
 template <class T, std::size_t N>
 inline constexpr auto length(const vec<T, N>& v) {
-	return std::sqrt(dot(v, v));
+	using std::sqrt;	 // finds sqrt(float8) for packets
+	return sqrt(dot(v, v));
 }
 
 template <class T, std::size_t N>
 inline constexpr auto normalize(const vec<T, N>& v) {
 	auto len = length(v);
-	if (len == 1e-6f) return v;		// Avoid division by zero
+	if (len < 1e-6f) return v;		// Avoid division by zero, zero length vectors are returned as they are
 	return v / len;
 }
 
@@ -79,29 +79,3 @@ inline constexpr auto refract(const vec<T, 3>& I, const vec<T, 3>& N, T eta) {
 		return I * eta - N * (eta * dot(N, I) + std::sqrt(k));
 	}
 }
-
-#define SIMD_OPERATOR_F3(op, f)                                                                      \
-	inline constexpr auto operator op(const vec<float, 3>& v1, const vec<float, 3>& v2) {            \
-		__m128			  va	 = _mm_set_ps(0.0f, v1.z, v1.y, v1.x);                               \
-		__m128			  vb	 = _mm_set_ps(0.0f, v2.z, v2.y, v2.x);                               \
-		__m128			  result = f(va, vb);                                                        \
-		alignas(16) float temp_result[4];                                                            \
-		_mm_maskstore_ps(temp_result, _mm_set_epi32(0, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF), result); \
-		return vec3{temp_result[0], temp_result[1], temp_result[2]};                                 \
-	}
-#define SIMD_OPERATOR_INPLACE_F3(op, f)                                                          \
-	inline constexpr auto operator op(vec<float, 3>& v1, const vec<float, 3>& v2) {              \
-		__m128 va	  = _mm_set_ps(0.0f, v1.z, v1.y, v1.x);                                      \
-		__m128 vb	  = _mm_set_ps(0.0f, v2.z, v2.y, v2.x);                                      \
-		__m128 result = f(va, vb);                                                               \
-		_mm_maskstore_ps(v1.data, _mm_set_epi32(0, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF), result); \
-	}
-
-// SIMD_OPERATOR_F3(+, _mm_add_ps);
-// SIMD_OPERATOR_F3(-, _mm_sub_ps);
-// SIMD_OPERATOR_F3(*, _mm_mul_ps);
-// SIMD_OPERATOR_F3(/, _mm_div_ps);
-// SIMD_OPERATOR_INPLACE_F3(+=, _mm_add_ps);
-// SIMD_OPERATOR_INPLACE_F3(-=, _mm_sub_ps);
-// SIMD_OPERATOR_INPLACE_F3(*=, _mm_mul_ps);
-// SIMD_OPERATOR_INPLACE_F3(/=, _mm_div_ps);
@@ -96,65 +96,3 @@ using vec4	= vec<float, 4>;
 using ivec4 = vec<int, 4>;
 using uvec4 = vec<unsigned int, 4>;
 using dvec4 = vec<double, 4>;
-
-#define SIMD_OPERATOR_F4(op, f)                                                           \
-	inline constexpr auto operator op(const vec<float, 4>& v1, const vec<float, 4>& v2) { \
-		__m128 va	  = _mm_load_ps(v1.data);                                             \
-		__m128 vb	  = _mm_load_ps(v2.data);                                             \
-		__m128 result = f(va, vb);                                                        \
-		vec4   v_result;                                                                  \
-		_mm_store_ps(v_result.data, result);                                              \
-		return v_result;                                                                  \
-	}
-#define SIMD_OPERATOR_INPLACE_F4(op, f)                                              \
-	inline constexpr auto& operator op(vec<float, 3>& v1, const vec<float, 3>& v2) { \
-		__m128 va	  = _mm_load_ps(v1.data);                                        \
-		__m128 vb	  = _mm_load_ps(v2.data);                                        \
-		__m128 result = f(va, vb);                                                   \
-		_mm_store_ps(v1.data, result);                                               \
-		return v1;                                                                   \
-	}
-
-#define SIMD_OPERATOR_F4_SCALAR(op, f)                                     \
-	inline constexpr auto operator op(const vec<float, 4>& v1, float v2) { \
-		__m128 va	  = _mm_load_ps(v1.data);                              \
-		__m128 vb	  = _mm_set1_ps(v2);                                   \
-		__m128 result = f(va, vb);                                         \
-		vec4   v_result;                                                   \
-		_mm_store_ps(v_result.data, result);                               \
-		return v_result;                                                   \
-	}
-
-#define SIMD_OPERATOR_INPLACE_F4_SCALAR(op, f)                        \
-	inline constexpr auto& operator op(vec<float, 4>& v1, float v2) { \
-		__m128 va	  = _mm_load_ps(v1.data);                         \
-		__m128 vb	  = _mm_set1_ps(v2);                              \
-		__m128 result = f(va, vb);                                    \
-		_mm_store_ps(v1.data, result);                                \
-		return v1;                                                    \
-	}
-
-//SIMD_OPERATOR_F4(+, _mm_add_ps);
-//SIMD_OPERATOR_F4(-, _mm_sub_ps);
-//SIMD_OPERATOR_F4(*, _mm_mul_ps);
-//SIMD_OPERATOR_F4(/, _mm_div_ps);
-//SIMD_OPERATOR_INPLACE_F4(+=, _mm_add_ps);
-//SIMD_OPERATOR_INPLACE_F4(-=, _mm_sub_ps);
-//SIMD_OPERATOR_INPLACE_F4(*=, _mm_mul_ps);
-//SIMD_OPERATOR_INPLACE_F4(/=, _mm_div_ps);
-//
-//inline constexpr auto dot(const vec<float, 4>& v1, const vec<float, 4>& v2) {
-//	__m128 a	  = _mm_load_ps(v1.data);
-//	__m128 b	  = _mm_load_ps(v2.data);
-//	__m128 result = _mm_dp_ps(a, b, 0xFF);
-//	return _mm_cvtss_f32(result);
-//}
-//
-//SIMD_OPERATOR_F4_SCALAR(+, _mm_add_ps);
-//SIMD_OPERATOR_F4_SCALAR(-, _mm_sub_ps);
-//SIMD_OPERATOR_F4_SCALAR(*, _mm_mul_ps);
-//SIMD_OPERATOR_F4_SCALAR(/, _mm_div_ps);
-//SIMD_OPERATOR_INPLACE_F4_SCALAR(+=, _mm_add_ps);
-//SIMD_OPERATOR_INPLACE_F4_SCALAR(-=, _mm_sub_ps);
-//SIMD_OPERATOR_INPLACE_F4_SCALAR(*=, _mm_mul_ps);
-//SIMD_OPERATOR_INPLACE_F4_SCALAR(/=, _mm_div_ps);